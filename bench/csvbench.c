@@ -0,0 +1,896 @@
+/**
+ * @file csvbench.c
+ *
+ * @brief Throughput benchmarks of the parsing paths, with comparison
+ *        against a baseline
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <malloc.h>     /* malloc_usable_size */
+#include <math.h>       /* fabs */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* SIZE_MAX */
+#include <stdio.h>      /* printf, fprintf, fopen, sscanf */
+#include <stdlib.h>     /* malloc, free, qsort, strtoul, strtod */
+#include <string.h>     /* strcmp, strrchr, strlen, memcpy */
+#include <sys/resource.h>   /* getrusage */
+#include <sys/stat.h>   /* stat */
+#include <sys/types.h>  /* pid_t */
+#include <sys/wait.h>   /* waitpid */
+#include <time.h>       /* clock_gettime */
+#include <unistd.h>     /* fork, pipe, read, write, getopt */
+
+/* Local includes */
+#include <csvbatch.h>
+#include <csvparallel.h>
+#include <csvparser.h>
+#include <csvpipeline.h>
+#include <csvschema.h>
+
+
+/* Rows per batch, for the batch paths */
+#define CSV_BENCH_ROWS 1024
+
+/* Bytes sampled to infer the schema, for the typed path */
+#define CSV_BENCH_SAMPLE (1024 * 1024)
+
+
+/**
+ * @typedef csv_bench_fn_td
+ *
+ * @brief Function parsing a whole file through one of the paths
+ *
+ * @param path    Path to the CSV file (with a header, comma-separated)
+ * @param records Where to store the number of records parsed
+ *
+ * @return @c true on success, @c false otherwise
+ */
+typedef bool (*csv_bench_fn_td)(const char *path, size_t *records);
+
+
+/*
+ * Allocations are counted by wrapping the allocator at link time
+ * (`-Wl,--wrap=malloc`, etc.), so only the calls made by the library
+ * and this program are seen.  @a strdup() is wrapped as well, since its
+ * result is freed through the wrapped @a free().
+ */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+void __wrap_free(void *ptr);
+char *__wrap_strdup(const char *s);
+
+/* Counters (updated by several threads); live bytes are only tracked
+ * while accounting, as they need the usable size of every block */
+static bool s_accounting = false;
+static size_t s_allocs = 0;
+static size_t s_alloc_bytes = 0;
+static size_t s_live = 0;
+static size_t s_peak_live = 0;
+
+
+/**
+ * @brief Account for a block that was just allocated
+ *
+ * @param ptr  Block allocated, or @c NULL if the allocation failed
+ * @param size Bytes requested
+ */
+static void s_account(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    __atomic_fetch_add(&s_allocs, 1, __ATOMIC_RELAXED);
+    if (!s_accounting) {
+        return;
+    }
+
+    __atomic_fetch_add(&s_alloc_bytes, size, __ATOMIC_RELAXED);
+    size_t live = __atomic_add_fetch(&s_live, malloc_usable_size(ptr),
+            __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&s_peak_live, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&s_peak_live, &peak,
+                live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        /* peak was reloaded; try again while still below */
+    }
+}
+
+
+/**
+ * @brief Account for a block that is about to be freed
+ *
+ * @param ptr Block to free, or @c NULL
+ */
+static void s_unaccount(void *ptr)
+{
+    if (ptr != NULL && s_accounting) {
+        __atomic_fetch_sub(&s_live, malloc_usable_size(ptr),
+                __ATOMIC_RELAXED);
+    }
+}
+
+
+/* Allocate, and account for the block */
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    s_account(ptr, size);
+
+    return ptr;
+}
+
+
+/* Allocate zeroed, and account for the block */
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __real_calloc(nmemb, size);
+    s_account(ptr, nmemb * size);
+
+    return ptr;
+}
+
+
+/* Reallocate, and account for the old and new blocks */
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    size_t old = (ptr != NULL && s_accounting) ? malloc_usable_size(ptr) : 0;
+    void *new_ptr = __real_realloc(ptr, size);
+
+    if (new_ptr != NULL || size == 0) {
+        __atomic_fetch_sub(&s_live, old, __ATOMIC_RELAXED);
+    }
+    s_account(new_ptr, size);
+
+    return new_ptr;
+}
+
+
+/* Account for the block, and free it */
+void __wrap_free(void *ptr)
+{
+    s_unaccount(ptr);
+    __real_free(ptr);
+}
+
+
+/* Duplicate a string with the wrapped allocator */
+char *__wrap_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *r = __wrap_malloc(len);
+
+    if (r != NULL) {
+        memcpy(r, s, len);
+    }
+
+    return r;
+}
+
+
+/**
+ * @brief Parse through @a csv_parser_row(), copying every row
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records parsed
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_row(const char *path, size_t *records)
+{
+    csv_parser_td *csv_parser = csv_parser_init(path, CSV_DELIM_COMMA,
+            CSV_HAS_HEADER);
+    csv_row_td *row;
+
+    if (csv_parser == NULL) {
+        return false;
+    }
+    while ((row = csv_parser_row(csv_parser)) != NULL) {
+        (*records)++;
+        csv_parser_destroy_row(row);
+    }
+    csv_parser_destroy(csv_parser);
+
+    return true;
+}
+
+
+/**
+ * @brief Parse through @a csv_parser_row_view(), without copying
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records parsed
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_view(const char *path, size_t *records)
+{
+    csv_parser_td *csv_parser = csv_parser_init(path, CSV_DELIM_COMMA,
+            CSV_HAS_HEADER);
+
+    if (csv_parser == NULL) {
+        return false;
+    }
+    while (csv_parser_row_view(csv_parser) != NULL) {
+        (*records)++;
+    }
+    csv_parser_destroy(csv_parser);
+
+    return true;
+}
+
+
+/**
+ * @brief Skip every record through @a csv_parser_skip()
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records skipped
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_skip(const char *path, size_t *records)
+{
+    csv_parser_td *csv_parser = csv_parser_init(path, CSV_DELIM_COMMA,
+            CSV_HAS_HEADER);
+
+    if (csv_parser == NULL) {
+        return false;
+    }
+    *records = csv_parser_skip(csv_parser, SIZE_MAX);
+    csv_parser_destroy(csv_parser);
+
+    return true;
+}
+
+
+/**
+ * @brief Count the records through @a csv_count_records()
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_count(const char *path, size_t *records)
+{
+    return csv_count_records(path, CSV_DELIM_COMMA, CSV_HAS_HEADER, 0,
+            records);
+}
+
+
+/**
+ * @brief Parse into columnar batches through @a csv_parser_batch()
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records parsed
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_batch(const char *path, size_t *records)
+{
+    csv_parser_td *csv_parser = csv_parser_init(path, CSV_DELIM_COMMA,
+            CSV_HAS_HEADER);
+    const csv_row_td *header = csv_parser_header(csv_parser);
+    csv_batch_td *csv_batch = (header) ?
+        csv_batch_init(header->num_fields, CSV_BENCH_ROWS) : NULL;
+    size_t n;
+
+    if (csv_batch == NULL) {
+        csv_parser_destroy(csv_parser);
+        return false;
+    }
+    while ((n = csv_parser_batch(csv_parser, csv_batch)) > 0) {
+        *records += n;
+    }
+    csv_batch_destroy(csv_batch);
+    csv_parser_destroy(csv_parser);
+
+    return true;
+}
+
+
+/**
+ * @brief Parse into typed batches, with an inferred schema, through
+ *        @a csv_parser_typed_batch()
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records parsed
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_typed(const char *path, size_t *records)
+{
+    csv_parser_td *csv_parser = csv_parser_init(path, CSV_DELIM_COMMA,
+            CSV_HAS_HEADER);
+    csv_schema_td *csv_schema = (csv_parser) ?
+        csv_infer_schema(csv_parser, CSV_BENCH_SAMPLE) : NULL;
+    csv_typed_batch_td *csv_batch = (csv_schema) ?
+        csv_typed_batch_init(csv_schema, CSV_BENCH_ROWS) : NULL;
+    size_t n;
+
+    csv_schema_destroy(csv_schema);
+    if (csv_batch == NULL) {
+        csv_parser_destroy(csv_parser);
+        return false;
+    }
+    while ((n = csv_parser_typed_batch(csv_parser, csv_batch)) > 0) {
+        *records += n;
+    }
+    csv_typed_batch_destroy(csv_batch);
+    csv_parser_destroy(csv_parser);
+
+    return true;
+}
+
+
+/**
+ * @brief Parse through @a csv_parallel_row_view(), one thread per
+ *        processor
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records parsed
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_parallel(const char *path, size_t *records)
+{
+    csv_parallel_td *csv_parallel = csv_parallel_init(path,
+            CSV_DELIM_COMMA, CSV_HAS_HEADER, 0);
+
+    if (csv_parallel == NULL) {
+        return false;
+    }
+    while (csv_parallel_row_view(csv_parallel) != NULL) {
+        (*records)++;
+    }
+    csv_parallel_destroy(csv_parallel);
+
+    return true;
+}
+
+
+/**
+ * @brief Parse through @a csv_pipeline_row_view()
+ *
+ * @param path    Path to the CSV file
+ * @param records Where to store the number of records parsed
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench_pipeline(const char *path, size_t *records)
+{
+    csv_pipeline_td *csv_pipeline = csv_pipeline_init(path,
+            CSV_DELIM_COMMA, CSV_HAS_HEADER, 0);
+
+    if (csv_pipeline == NULL) {
+        return false;
+    }
+    while (csv_pipeline_row_view(csv_pipeline) != NULL) {
+        (*records)++;
+    }
+    bool ok = !csv_pipeline_failed(csv_pipeline);
+    csv_pipeline_destroy(csv_pipeline);
+
+    return ok;
+}
+
+
+/**
+ * @brief Paths to benchmark
+ */
+static const struct {
+    const char *name;       /**< Name of the path */
+    csv_bench_fn_td fn;     /**< Function parsing through it */
+} s_paths[] = {
+    { "row", s_bench_row },
+    { "view", s_bench_view },
+    { "skip", s_bench_skip },
+    { "count", s_bench_count },
+    { "batch", s_bench_batch },
+    { "typed", s_bench_typed },
+    { "parallel", s_bench_parallel },
+    { "pipeline", s_bench_pipeline },
+};
+
+
+/**
+ * @brief Get the time of a monotonic clock
+ *
+ * @return Time, in seconds
+ */
+static double s_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+
+/**
+ * @typedef csv_bench_run_td
+ *
+ * @brief Structure for the outcome of a single run of a path
+ */
+typedef struct {
+    bool ok;            /**< Whether the path succeeded */
+    size_t records;     /**< Records parsed */
+    size_t allocs;      /**< Allocations made */
+    size_t alloc_bytes; /**< Bytes requested (when accounting) */
+    size_t peak_live;   /**< Peak of live bytes (when accounting) */
+    double elapsed;     /**< Time taken, in seconds */
+    long max_rss;       /**< Peak resident set size, in kB */
+} csv_bench_run_td;
+
+
+/**
+ * @typedef csv_bench_result_td
+ *
+ * @brief Structure for the summary of the runs of a path over a file
+ */
+typedef struct {
+    const char *file;   /**< Name of the file (without directories) */
+    const char *path;   /**< Name of the path */
+    size_t records;     /**< Records parsed */
+    double mb_s;        /**< Median throughput, in MB/s */
+    double mad;         /**< Median absolute deviation of it */
+    double allocs;      /**< Allocations per record */
+    long max_rss;       /**< Highest peak resident set size, in kB */
+} csv_bench_result_td;
+
+
+/**
+ * @brief Run a path once and get its outcome
+ *
+ * Runs in a child process of its own, so that its peak resident set
+ * size isn't the one of a previous run; the outcome is sent back
+ * through a pipe.
+ *
+ * @param path       Path to the CSV file
+ * @param index      Index of the path in @a s_paths
+ * @param accounting Whether to account for bytes, besides allocations
+ * @param run        Where to store the outcome
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_run(const char *path, size_t index, bool accounting,
+        csv_bench_run_td *run)
+{
+    int fds[2];
+    int status;
+
+    fflush(stdout);
+    if (pipe(fds) == -1) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    } else if (pid == 0) {
+        struct rusage usage;
+        csv_bench_run_td child = { false, 0, 0, 0, 0, 0.0, 0 };
+
+        close(fds[0]);
+        s_allocs = s_alloc_bytes = s_live = s_peak_live = 0;
+        s_accounting = accounting;
+        double start = s_now();
+        child.ok = s_paths[index].fn(path, &child.records);
+        child.elapsed = s_now() - start;
+        child.allocs = __atomic_load_n(&s_allocs, __ATOMIC_RELAXED);
+        child.alloc_bytes = __atomic_load_n(&s_alloc_bytes,
+                __ATOMIC_RELAXED);
+        child.peak_live = __atomic_load_n(&s_peak_live, __ATOMIC_RELAXED);
+        getrusage(RUSAGE_SELF, &usage);
+        child.max_rss = usage.ru_maxrss;
+
+        bool sent = (write(fds[1], &child, sizeof(child)) ==
+                (ssize_t) sizeof(child));
+        _exit((sent) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    bool received = (read(fds[0], run, sizeof(*run)) ==
+            (ssize_t) sizeof(*run));
+    close(fds[0]);
+
+    return (waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+            WEXITSTATUS(status) == EXIT_SUCCESS && received && run->ok);
+}
+
+
+/**
+ * @brief Compare two doubles, for @a qsort()
+ *
+ * @param a First double
+ * @param b Second double
+ *
+ * @return Negative, zero or positive as @p a is less than, equal to or
+ *         greater than @p b
+ */
+static int s_cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * @brief Get the median of some values, sorting them
+ *
+ * @param values Values (sorted on return)
+ * @param n      Number of values (at least one)
+ *
+ * @return Median of the values
+ */
+static double s_median(double *values, size_t n)
+{
+    qsort(values, n, sizeof(*values), s_cmp_double);
+
+    return (n % 2) ? values[n / 2] :
+        (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+
+/**
+ * @brief Run a path several times over a file and summarize the runs
+ *
+ * @param path   Path to the CSV file
+ * @param size   Size of the file, in bytes
+ * @param index  Index of the path in @a s_paths
+ * @param runs   Number of runs (at least one)
+ * @param result Where to store the summary
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_bench(const char *path, double size, size_t index,
+        size_t runs, csv_bench_result_td *result)
+{
+    double *mb_s = malloc(sizeof(*mb_s) * runs);
+    csv_bench_run_td run;
+
+    if (mb_s == NULL) {
+        return false;
+    }
+
+    result->max_rss = 0;
+    for (size_t i = 0; i < runs; ++i) {
+        if (!s_run(path, index, false, &run)) {
+            free(mb_s);
+            return false;
+        }
+        mb_s[i] = size / (1024.0 * 1024.0) / run.elapsed;
+        if (run.max_rss > result->max_rss) {
+            result->max_rss = run.max_rss;
+        }
+    }
+
+    /* Allocations and records don't change from run to run */
+    result->records = run.records;
+    result->allocs = (run.records) ?
+        (double) run.allocs / (double) run.records : 0.0;
+    result->mb_s = s_median(mb_s, runs);
+    for (size_t i = 0; i < runs; ++i) {
+        mb_s[i] = fabs(mb_s[i] - result->mb_s);
+    }
+    result->mad = s_median(mb_s, runs);
+    free(mb_s);
+
+    return true;
+}
+
+
+/**
+ * @brief Write the results as JSON, one result per line
+ *
+ * @param filename    Where to write them
+ * @param results     Results to write
+ * @param num_results Number of results
+ * @param runs        Number of runs of every result
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_write_json(const char *filename,
+        const csv_bench_result_td *results, size_t num_results, size_t runs)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        return false;
+    }
+
+    fprintf(fp, "{\"runs\": %zu, \"results\": [\n", runs);
+    for (size_t i = 0; i < num_results; ++i) {
+        const csv_bench_result_td *result = &results[i];
+        fprintf(fp, "  {\"file\": \"%s\", \"path\": \"%s\", "
+                "\"mb_s\": %.3f, \"mad\": %.3f, \"records\": %zu, "
+                "\"allocs_per_record\": %.3f, \"peak_rss_kb\": %ld}%s\n",
+                result->file, result->path, result->mb_s, result->mad,
+                result->records, result->allocs, result->max_rss,
+                (i + 1 < num_results) ? "," : "");
+    }
+    fprintf(fp, "]}\n");
+
+    return (fclose(fp) == 0);
+}
+
+
+/**
+ * @brief Find a result in a baseline written by @a s_write_json()
+ *
+ * @param fp     Baseline file
+ * @param result Result whose file and path to look for
+ * @param mb_s   Where to store the median throughput of the baseline
+ * @param mad    Where to store its median absolute deviation
+ *
+ * @return @c true if found, @c false otherwise
+ */
+static bool s_find_baseline(FILE *fp, const csv_bench_result_td *result,
+        double *mb_s, double *mad)
+{
+    char line[512];
+    char file[256];
+    char path[64];
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, " {\"file\": \"%255[^\"]\", \"path\": \"%63[^\"]\", "
+                    "\"mb_s\": %lf, \"mad\": %lf", file, path, mb_s, mad)
+                == 4 && strcmp(file, result->file) == 0 &&
+                strcmp(path, result->path) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Compare a result with the baseline and print the verdict
+ *
+ * A result regresses when its median throughput is lower than the
+ * baseline by more than @p threshold percent, and by more than the
+ * noise of both measurements (three times the sum of their MADs, each
+ * scaled to estimate a standard deviation).
+ *
+ * @param baseline  Baseline file, or @c NULL
+ * @param result    Result to compare
+ * @param threshold Relative change to ignore, in percent
+ *
+ * @return @c true if the result regressed, @c false otherwise
+ */
+static bool s_compare(FILE *baseline, const csv_bench_result_td *result,
+        double threshold)
+{
+    double mb_s, mad;
+
+    if (baseline == NULL) {
+        printf("\n");
+        return false;
+    } else if (!s_find_baseline(baseline, result, &mb_s, &mad) ||
+            mb_s <= 0.0) {
+        printf(" %9s\n", "new");
+        return false;
+    }
+
+    double change = (result->mb_s - mb_s) / mb_s * 100.0;
+    double noise = 3.0 * 1.4826 * (mad + result->mad);
+    bool beyond = (fabs(change) > threshold &&
+            fabs(result->mb_s - mb_s) > noise);
+
+    printf(" %+8.1f%%%s\n", change, (!beyond) ? "" :
+            (change < 0.0) ? "  REGRESSION" : "  faster");
+
+    return (beyond && change < 0.0);
+}
+
+
+/**
+ * @brief Account for the allocations of every path over a file, and
+ *        print them
+ *
+ * @param path   Path to the CSV file
+ * @param wanted Whether every path in @a s_paths has to be run
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_account_paths(const char *path, const bool *wanted)
+{
+    bool ok = true;
+    csv_bench_run_td run;
+
+    printf("%s (allocation accounting)\n", path);
+    printf("  %-10s %12s %12s %12s %14s\n", "path", "records",
+            "allocs/rec", "bytes/rec", "peak live kB");
+
+    for (size_t i = 0; i < sizeof(s_paths) / sizeof(s_paths[0]); ++i) {
+        if (!wanted[i]) {
+            continue;
+        } else if (!s_run(path, i, true, &run)) {
+            printf("  %-10s %s\n", s_paths[i].name, "failed");
+            ok = false;
+            continue;
+        }
+
+        double records = (run.records) ? (double) run.records : 1.0;
+        printf("  %-10s %12zu %12.3f %12.1f %14.1f\n", s_paths[i].name,
+                run.records, (double) run.allocs / records,
+                (double) run.alloc_bytes / records,
+                (double) run.peak_live / 1024.0);
+    }
+
+    return ok;
+}
+
+
+/**
+ * @brief Print the usage of the program
+ *
+ * @param name Name of the program
+ */
+static void s_usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-r RUNS] [-p PATH]... [-j JSON] "
+            "[-b BASELINE] [-t PERCENT] FILE...\n"
+            "       %s -a [-p PATH]... FILE...\n", name, name);
+}
+
+
+int main(int argc, char **argv)
+{
+    const char *json = NULL;
+    const char *baseline_file = NULL;
+    const char *selected[sizeof(s_paths) / sizeof(s_paths[0])];
+    bool wanted[sizeof(s_paths) / sizeof(s_paths[0])];
+    size_t num_selected = 0;
+    size_t num_paths = sizeof(s_paths) / sizeof(s_paths[0]);
+    bool accounting = false;
+    size_t runs = 5;
+    double threshold = 5.0;
+    bool ok = true;
+    bool regressed = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ar:p:j:b:t:")) != -1) {
+        switch (opt) {
+            case 'a':
+                accounting = true;
+                break;
+            case 'r':
+                runs = (size_t) strtoul(optarg, NULL, 10);
+                break;
+            case 'p':
+                if (num_selected < num_paths) {
+                    selected[num_selected++] = optarg;
+                }
+                break;
+            case 'j':
+                json = optarg;
+                break;
+            case 'b':
+                baseline_file = optarg;
+                break;
+            case 't':
+                threshold = strtod(optarg, NULL);
+                break;
+            default:
+                s_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || runs == 0) {
+        s_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < num_paths; ++i) {
+        wanted[i] = (num_selected == 0);
+        for (size_t j = 0; j < num_selected; ++j) {
+            wanted[i] = wanted[i] || strcmp(selected[j], s_paths[i].name) == 0;
+        }
+    }
+
+    if (accounting) {
+        for (int f = optind; f < argc; ++f) {
+            ok = s_account_paths(argv[f], wanted) && ok;
+        }
+        return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /* A missing baseline isn't an error: there's nothing to compare */
+    FILE *baseline = (baseline_file) ? fopen(baseline_file, "r") : NULL;
+    size_t num_files = (size_t) (argc - optind);
+    csv_bench_result_td *results =
+        malloc(sizeof(*results) * num_files * num_paths);
+    size_t num_results = 0;
+    if (results == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    for (int f = optind; f < argc; ++f) {
+        const char *file = strrchr(argv[f], '/');
+        file = (file) ? file + 1 : argv[f];
+
+        struct stat st;
+        if (stat(argv[f], &st) == -1) {
+            perror(argv[f]);
+            ok = false;
+            continue;
+        }
+
+        double size = (double) st.st_size;
+        printf("%s (%.1f MB, median of %zu runs)\n", argv[f],
+                size / (1024.0 * 1024.0), runs);
+        printf("  %-10s %10s %8s %14s %12s %12s%s\n", "path", "MB/s",
+                "MAD", "records/s", "allocs/rec", "peak RSS kB",
+                (baseline) ? "  vs. baseline" : "");
+
+        for (size_t i = 0; i < num_paths; ++i) {
+            if (!wanted[i]) {
+                continue;
+            }
+
+            csv_bench_result_td *result = &results[num_results];
+            result->file = file;
+            result->path = s_paths[i].name;
+            if (!s_bench(argv[f], size, i, runs, result)) {
+                printf("  %-10s %s\n", s_paths[i].name, "failed");
+                ok = false;
+                continue;
+            }
+            num_results++;
+
+            printf("  %-10s %10.1f %8.1f %14.0f %12.3f %12ld",
+                    result->path, result->mb_s, result->mad,
+                    result->mb_s * 1024.0 * 1024.0 / size *
+                    (double) result->records,
+                    result->allocs, result->max_rss);
+            regressed = s_compare(baseline, result, threshold) || regressed;
+        }
+    }
+
+    if (json != NULL && !s_write_json(json, results, num_results, runs)) {
+        perror(json);
+        ok = false;
+    }
+    if (baseline != NULL) {
+        fclose(baseline);
+    }
+    free(results);
+
+    return (ok && !regressed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
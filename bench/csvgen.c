@@ -0,0 +1,457 @@
+/**
+ * @file csvgen.c
+ *
+ * @brief Deterministic generator of synthetic CSV corpora
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* uint64_t, UINT64_C */
+#include <stdio.h>      /* FILE, fopen, fwrite, snprintf */
+#include <stdlib.h>     /* strtoull, EXIT_SUCCESS, EXIT_FAILURE */
+#include <string.h>     /* strcmp, strlen */
+
+
+/* Seed used when none is given, so that corpora are reproducible */
+#define CSV_GEN_SEED UINT64_C(0x2545f4914f6cdd1d)
+
+/* Number of columns of the wide corpus */
+#define CSV_GEN_WIDE 500
+
+/* Maximum number of fields of a ragged row */
+#define CSV_GEN_RAGGED 24
+
+
+/**
+ * @typedef csv_gen_td
+ *
+ * @brief Structure for the state of the generator
+ */
+typedef struct {
+    FILE *fp;           /**< Output file */
+    uint64_t bytes;     /**< Bytes written so far */
+    uint64_t rng;       /**< State of the pseudo-random generator */
+} csv_gen_td;
+
+
+/**
+ * @typedef csv_gen_row_fn_td
+ *
+ * @brief Function writing the header (@p row is @c 0) or a row
+ */
+typedef void (*csv_gen_row_fn_td)(csv_gen_td *gen, uint64_t row);
+
+
+/**
+ * @brief Get the next pseudo-random number (xorshift64*)
+ *
+ * @param gen Generator whose state to advance
+ *
+ * @return Next pseudo-random number
+ */
+static uint64_t s_rand(csv_gen_td *gen)
+{
+    gen->rng ^= gen->rng >> 12;
+    gen->rng ^= gen->rng << 25;
+    gen->rng ^= gen->rng >> 27;
+
+    return gen->rng * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+
+/**
+ * @brief Get a pseudo-random number below a bound
+ *
+ * @param gen Generator whose state to advance
+ * @param n   Bound (not zero)
+ *
+ * @return Pseudo-random number in [0, @p n)
+ */
+static uint64_t s_below(csv_gen_td *gen, uint64_t n)
+{
+    return (s_rand(gen) >> 11) % n;
+}
+
+
+/**
+ * @brief Write bytes to the output
+ *
+ * @param gen Generator where to write
+ * @param s   Bytes to write
+ * @param len Number of bytes of @p s
+ */
+static void s_write(csv_gen_td *gen, const char *s, size_t len)
+{
+    gen->bytes += fwrite(s, 1, len, gen->fp);
+}
+
+
+/**
+ * @brief Write a null-terminated string to the output
+ *
+ * @param gen Generator where to write
+ * @param s   String to write
+ */
+static void s_puts(csv_gen_td *gen, const char *s)
+{
+    s_write(gen, s, strlen(s));
+}
+
+
+/**
+ * @brief Write an unsigned integer to the output
+ *
+ * @param gen Generator where to write
+ * @param n   Number to write
+ */
+static void s_uint(csv_gen_td *gen, uint64_t n)
+{
+    char s[24];
+    int len = snprintf(s, sizeof(s), "%llu", (unsigned long long) n);
+    s_write(gen, s, (size_t) len);
+}
+
+
+/**
+ * @brief Write a decimal number with three decimals to the output
+ *
+ * @param gen Generator where to write
+ */
+static void s_decimal(csv_gen_td *gen)
+{
+    char s[32];
+    int len = snprintf(s, sizeof(s), "%s%llu.%03llu",
+            (s_below(gen, 4) == 0) ? "-" : "",
+            (unsigned long long) s_below(gen, 100000),
+            (unsigned long long) s_below(gen, 1000));
+    s_write(gen, s, (size_t) len);
+}
+
+
+/**
+ * @brief Write a random lowercase word to the output
+ *
+ * @param gen     Generator where to write
+ * @param max_len Maximum length of the word (at least one)
+ */
+static void s_word(csv_gen_td *gen, size_t max_len)
+{
+    char s[64];
+    size_t len = 1 + (size_t) s_below(gen, max_len);
+    for (size_t i = 0; i < len && i < sizeof(s); ++i) {
+        s[i] = (char) ('a' + s_below(gen, 26));
+    }
+    s_write(gen, s, (len < sizeof(s)) ? len : sizeof(s));
+}
+
+
+/**
+ * @brief Write a header of numbered column names
+ *
+ * @param gen         Generator where to write
+ * @param num_columns Number of columns
+ * @param eol         Line terminator
+ */
+static void s_header(csv_gen_td *gen, size_t num_columns, const char *eol)
+{
+    for (size_t i = 0; i < num_columns; ++i) {
+        s_puts(gen, (i > 0) ? ",c" : "c");
+        s_uint(gen, i);
+    }
+    s_puts(gen, eol);
+}
+
+
+/**
+ * @brief Write a narrow row of numbers, with a given line terminator
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ * @param eol Line terminator
+ */
+static void s_numeric_row(csv_gen_td *gen, uint64_t row, const char *eol)
+{
+    if (row == 0) {
+        s_puts(gen, "id,qty,price,ratio,code,flag");
+        s_puts(gen, eol);
+        return;
+    }
+
+    s_uint(gen, row);
+    s_puts(gen, ",");
+    s_uint(gen, s_below(gen, 1000));
+    s_puts(gen, ",");
+    s_decimal(gen);
+    s_puts(gen, ",");
+    s_decimal(gen);
+    s_puts(gen, ",");
+    s_uint(gen, s_below(gen, UINT64_C(1) << 32));
+    s_puts(gen, (s_below(gen, 2)) ? ",1" : ",0");
+    s_puts(gen, eol);
+}
+
+
+/**
+ * @brief Write a narrow numeric row, LF-terminated
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ */
+static void s_narrow(csv_gen_td *gen, uint64_t row)
+{
+    s_numeric_row(gen, row, "\n");
+}
+
+
+/**
+ * @brief Write a narrow numeric row, CRLF-terminated
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ */
+static void s_crlf(csv_gen_td *gen, uint64_t row)
+{
+    s_numeric_row(gen, row, "\r\n");
+}
+
+
+/**
+ * @brief Write a row of many small integers
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ */
+static void s_wide(csv_gen_td *gen, uint64_t row)
+{
+    if (row == 0) {
+        s_header(gen, CSV_GEN_WIDE, "\n");
+        return;
+    }
+
+    for (size_t i = 0; i < CSV_GEN_WIDE; ++i) {
+        if (i > 0) {
+            s_puts(gen, ",");
+        }
+        s_uint(gen, s_below(gen, 10000));
+    }
+    s_puts(gen, "\n");
+}
+
+
+/**
+ * @brief Write a row whose fields are all quoted, with escaped quotes,
+ *        delimiters and newlines inside
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ */
+static void s_quoted(csv_gen_td *gen, uint64_t row)
+{
+    if (row == 0) {
+        s_header(gen, 8, "\n");
+        return;
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+        s_puts(gen, (i > 0) ? ",\"" : "\"");
+        for (size_t w = 1 + (size_t) s_below(gen, 4); w > 0; --w) {
+            s_word(gen, 10);
+            switch (s_below(gen, 8)) {
+                case 0:
+                    s_puts(gen, "\"\"");
+                    break;
+                case 1:
+                    s_puts(gen, ", ");
+                    break;
+                case 2:
+                    s_puts(gen, (s_below(gen, 4) == 0) ? "\n" : " ");
+                    break;
+                default:
+                    s_puts(gen, " ");
+                    break;
+            }
+        }
+        s_puts(gen, "\"");
+    }
+    s_puts(gen, "\n");
+}
+
+
+/**
+ * @brief Write a row with a long free-text field
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ */
+static void s_text(csv_gen_td *gen, uint64_t row)
+{
+    if (row == 0) {
+        s_puts(gen, "id,title,body,tag\n");
+        return;
+    }
+
+    s_uint(gen, row);
+    s_puts(gen, ",");
+    s_word(gen, 20);
+    s_puts(gen, ",");
+    size_t len = 512 + (size_t) s_below(gen, 3584);
+    for (uint64_t start = gen->bytes; gen->bytes - start < len; ) {
+        s_word(gen, 12);
+        s_puts(gen, " ");
+    }
+    s_puts(gen, ",");
+    s_word(gen, 8);
+    s_puts(gen, "\n");
+}
+
+
+/**
+ * @brief Write a numeric row among comment, blank and whitespace lines
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ */
+static void s_comments(csv_gen_td *gen, uint64_t row)
+{
+    if (row > 0) {
+        switch (s_below(gen, 6)) {
+            case 0:
+            case 1:
+                s_puts(gen, "# ");
+                s_word(gen, 30);
+                s_puts(gen, ", ");
+                s_word(gen, 30);
+                s_puts(gen, "\n");
+                break;
+            case 2:
+                s_puts(gen, "\n");
+                break;
+            case 3:
+                s_puts(gen, "   \t\n");
+                break;
+            default:
+                break;
+        }
+    }
+
+    s_numeric_row(gen, row, "\n");
+}
+
+
+/**
+ * @brief Write a row with a random number of fields
+ *
+ * @param gen Generator where to write
+ * @param row Row number (@c 0 for the header)
+ */
+static void s_ragged(csv_gen_td *gen, uint64_t row)
+{
+    if (row == 0) {
+        s_header(gen, CSV_GEN_RAGGED, "\n");
+        return;
+    }
+
+    size_t num_fields = 1 + (size_t) s_below(gen, CSV_GEN_RAGGED);
+    for (size_t i = 0; i < num_fields; ++i) {
+        if (i > 0) {
+            s_puts(gen, ",");
+        }
+        if (s_below(gen, 2)) {
+            s_uint(gen, s_below(gen, 100000));
+        } else {
+            s_word(gen, 12);
+        }
+    }
+    s_puts(gen, "\n");
+}
+
+
+/**
+ * @brief Kinds of corpora
+ */
+static const struct {
+    const char *name;       /**< Name of the kind */
+    csv_gen_row_fn_td fn;   /**< Row writer */
+} s_kinds[] = {
+    { "narrow", s_narrow },
+    { "wide", s_wide },
+    { "quoted", s_quoted },
+    { "text", s_text },
+    { "crlf", s_crlf },
+    { "comments", s_comments },
+    { "ragged", s_ragged },
+};
+
+
+int main(int argc, char **argv)
+{
+    csv_gen_row_fn_td fn = NULL;
+
+    if (argc < 4 || argc > 5) {
+        fprintf(stderr, "Usage: %s KIND MEGABYTES FILE [SEED]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < sizeof(s_kinds) / sizeof(s_kinds[0]); ++i) {
+        if (strcmp(argv[1], s_kinds[i].name) == 0) {
+            fn = s_kinds[i].fn;
+        }
+    }
+    if (fn == NULL) {
+        fprintf(stderr, "%s: unknown kind '%s'\n", argv[0], argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t target = strtoull(argv[2], NULL, 10) * 1024 * 1024;
+    csv_gen_td gen = { NULL, 0, CSV_GEN_SEED };
+    if (argc == 5) {
+        gen.rng = strtoull(argv[4], NULL, 0);
+        if (gen.rng == 0) {
+            gen.rng = CSV_GEN_SEED;
+        }
+    }
+
+    gen.fp = fopen(argv[3], "wb");
+    if (gen.fp == NULL) {
+        perror(argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    /* The size is reached at a row boundary, so it's slightly exceeded */
+    for (uint64_t row = 0; row == 0 || gen.bytes < target; ++row) {
+        fn(&gen, row);
+    }
+
+    if (fclose(gen.fp) != 0) {
+        perror(argv[3]);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/**
+ * @file csvbatch.h
+ *
+ * @brief Columnar batches of CSV rows declaration
+ *
+ * A batch stores a number of consecutive rows in column-major order:
+ * every column keeps the bytes of all its values back to back in
+ * a single buffer, plus an array of offsets where value @e i spans
+ * from @c offsets[i] to @c offsets[i + 1] (the same variable-length
+ * layout used by Apache Arrow).  This lets vectorized code consume
+ * a whole column without transposing rows first.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_BATCH_H
+#define CSV_BATCH_H
+
+/* System includes */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+
+/* Local includes */
+#include <csvparser.h>
+
+
+/**
+ * @typedef csv_column_td
+ *
+ * @brief Structure for a column of a batch
+ */
+typedef struct {
+    char *values;       /**< Bytes of every value, back to back */
+    size_t values_len;  /**< Number of bytes used in @e values */
+    size_t values_cap;  /**< Number of bytes allocated for @e values */
+    size_t *offsets;    /**< Value offsets (@e num_rows + 1 entries) */
+} csv_column_td;
+
+
+/**
+ * @typedef csv_batch_td
+ *
+ * @brief Structure for a batch of rows stored column by column
+ */
+typedef struct {
+    csv_column_td *columns; /**< Columns of the batch */
+    size_t num_columns;     /**< Number of columns */
+    size_t num_rows;        /**< Number of rows stored */
+    size_t max_rows;        /**< Maximum number of rows per batch */
+} csv_batch_td;
+
+
+/* Public interface */
+/**
+ * @brief Initialize an empty batch
+ *
+ * @param num_columns Number of columns, usually the number of fields
+ *                    of the header
+ * @param max_rows    Maximum number of rows the batch can hold
+ *
+ * @return Pointer to the new batch, or @c NULL otherwise
+ */
+csv_batch_td *csv_batch_init(size_t num_columns, size_t max_rows);
+
+/**
+ * @brief Deallocate the memory used by a batch
+ *
+ * @param csv_batch Batch to free
+ */
+void csv_batch_destroy(csv_batch_td *csv_batch);
+
+/**
+ * @brief Remove all rows from a batch, keeping its buffers for reuse
+ *
+ * @param csv_batch Batch to clear
+ */
+void csv_batch_clear(csv_batch_td *csv_batch);
+
+/**
+ * @brief Append a row to a batch
+ *
+ * @param csv_batch Batch where to append the row
+ * @param view      Row to append
+ *
+ * @return @c true on success, @c false if the batch is full or on
+ *         allocation failure
+ *
+ * @note Missing trailing fields are stored as empty values, and fields
+ *       beyond the number of columns of the batch are ignored.
+ */
+bool csv_batch_append(csv_batch_td *csv_batch, const csv_row_view_td *view);
+
+/**
+ * @brief Append a value to a column
+ *
+ * @param column Column where to append the value
+ * @param row    Index of the new value; it must be the number of values
+ *               already stored in @p column
+ * @param data   Bytes of the value
+ * @param len    Number of bytes of the value
+ *
+ * @return @c true on success, @c false on allocation failure
+ *
+ * @note @e column->offsets must have room for @p row + 2 entries.
+ */
+bool csv_column_append(csv_column_td *column, size_t row, const char *data,
+        size_t len);
+
+/**
+ * @brief Fill a batch with the next rows of the CSV file
+ *
+ * The batch is cleared first and then filled with up to
+ * @e csv_batch->max_rows rows.
+ *
+ * @param csv_parser CSV parser where to read the rows from
+ * @param csv_batch  Batch to fill
+ *
+ * @return Number of rows stored in the batch, @c 0 on EOF or error
+ *
+ * @note On error, the batch is left empty, and the parser is moved back
+ *       to where it was, so the rows read are read again by the next
+ *       call.
+ */
+size_t csv_parser_batch(csv_parser_td *csv_parser, csv_batch_td *csv_batch);
+
+/**
+ * @brief Get a value of a batch
+ *
+ * @param csv_batch Batch where to get the value from
+ * @param column    Column index
+ * @param row       Row index within the batch
+ * @param len       If not @c NULL, set to the length of the value
+ *
+ * @return Pointer to the first byte of the value, or @c NULL if out of
+ *         bounds
+ *
+ * @note Values are not null-terminated; use @p len.
+ */
+const char *csv_batch_value(const csv_batch_td *csv_batch, size_t column,
+        size_t row, size_t *len);
+
+
+#endif /* ! CSV_BATCH_H */
@@ -0,0 +1,133 @@
+/**
+ * @file csvcache.h
+ *
+ * @brief Persistent parse cache declaration
+ *
+ * The parse cache of @c file.csv is stored in @c file.csv.cache, or in a
+ * cache directory under a name derived from the path.  It holds where
+ * every record is in the file, the line it ends at, and its fields,
+ * already unescaped; loading it maps the file in memory, so a parser
+ * reads the rows from there instead of scanning and splitting them.
+ * The size and modification time of the CSV file, and a hash of its
+ * first block, are recorded to tell when the cache is stale.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_CACHE_H
+#define CSV_CACHE_H
+
+/* System includes */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+#include <stdint.h>     /* uint64_t, int64_t */
+
+
+/* Number of bytes at the start of a CSV file hashed for its cache */
+#ifndef CSV_CACHE_BLOCK
+#define CSV_CACHE_BLOCK (64 * 1024)
+#endif
+
+/* Suffix appended to the name of a CSV file for its cache */
+#define CSV_CACHE_SUFFIX ".cache"
+
+
+/**
+ * @typedef csv_cache_record_td
+ *
+ * @brief Structure for the position of a record and of its fields
+ */
+typedef struct {
+    uint64_t offset;        /**< File offset where the record starts */
+    uint64_t end;           /**< File offset right after it (line
+                                 terminator included) */
+    uint64_t lines;         /**< Lines up to its end */
+    uint64_t field;         /**< Index of its first field */
+} csv_cache_record_td;
+
+
+/**
+ * @typedef csv_cache_td
+ *
+ * @brief Structure for a parse cache mapped in memory
+ */
+typedef struct {
+    void *map;              /**< Mapping of the cache file */
+    size_t map_len;         /**< Length of the mapping */
+    uint64_t size;          /**< Size of the cached file */
+    bool last_newline;      /**< Whether its last byte is a newline */
+    char delim;             /**< Delimiter used to split */
+    const csv_cache_record_td *records; /**< Every record, and one past
+                                             the last as sentinel (with
+                                             the lines of the file) */
+    size_t num_records;     /**< Records in the file (header included) */
+    const uint64_t *fields; /**< Offset of every field in @e values, and
+                                 one past the last as sentinel */
+    size_t num_fields;      /**< Fields in the file */
+    const char *values;     /**< Unescaped fields, each followed by a
+                                 null byte */
+} csv_cache_td;
+
+
+/* Public interface */
+/**
+ * @brief Build the parse cache of a CSV file
+ *
+ * @param path  Path to the CSV file (a regular file)
+ * @param delim Delimiter between fields
+ * @param dir   Directory where to store the cache, or @c NULL to store
+ *              it next to the CSV file
+ *
+ * @return @c true on success, @c false otherwise
+ *
+ * @note The cache is written to a temporary file first and renamed, so
+ *       readers never see a partial cache.
+ * @note Offsets are stored in the byte order of the machine.
+ */
+bool csv_cache_build(const char *path, const char *delim, const char *dir);
+
+/**
+ * @brief Load the parse cache of a CSV file
+ *
+ * @param path  Path to the CSV file
+ * @param delim Delimiter character the cache must have been built with
+ * @param dir   Directory where the cache is stored, or @c NULL if it's
+ *              next to the CSV file
+ *
+ * @return Pointer to the cache, or @c NULL if it's missing, corrupt,
+ *         built with another delimiter or for another path, or stale
+ *         (the size, the modification time or the first block of the
+ *         CSV file changed)
+ */
+csv_cache_td *csv_cache_load(const char *path, char delim, const char *dir);
+
+/**
+ * @brief Unmap and deallocate a cache
+ *
+ * @param cache Cache to free
+ */
+void csv_cache_destroy(csv_cache_td *cache);
+
+
+#endif /* ! CSV_CACHE_H */
@@ -0,0 +1,123 @@
+/**
+ * @file csvdict.h
+ *
+ * @brief Dictionary encoding of CSV values declaration
+ *
+ * A dictionary interns values: every distinct value is stored once and
+ * identified by a small integer code, assigned in order of appearance
+ * (0, 1, 2...).  Low-cardinality columns (countries, statuses,
+ * currencies...) can then be kept as arrays of codes that point to
+ * a shared dictionary, and grouped by integer keys.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_DICT_H
+#define CSV_DICT_H
+
+/* System includes */
+#include <stddef.h>     /* size_t */
+#include <stdint.h>     /* uint32_t, uint64_t */
+
+
+#define CSV_DICT_NO_CODE ((uint32_t) -1)
+
+
+/**
+ * @typedef csv_dict_td
+ *
+ * @brief Structure for a dictionary of interned values
+ */
+typedef struct {
+    char *values;           /**< Null-terminated values, back to back */
+    size_t values_len;      /**< Number of bytes used in @e values */
+    size_t values_cap;      /**< Number of bytes allocated for @e values */
+    size_t *offsets;        /**< Start of every value in @e values */
+    uint64_t *hashes;       /**< Hash of every value */
+    size_t num_values;      /**< Number of distinct values */
+    size_t values_max;      /**< Capacity of @e offsets and @e hashes */
+    uint32_t *table;        /**< Hash table of codes plus one (0: empty) */
+    size_t table_cap;       /**< Number of slots (power of two) */
+} csv_dict_td;
+
+
+/* Public interface */
+/**
+ * @brief Initialize an empty dictionary
+ *
+ * @return Pointer to the new dictionary, or @c NULL otherwise
+ */
+csv_dict_td *csv_dict_init(void);
+
+/**
+ * @brief Deallocate the memory used by a dictionary
+ *
+ * @param csv_dict Dictionary to free
+ */
+void csv_dict_destroy(csv_dict_td *csv_dict);
+
+/**
+ * @brief Get the code of a value, adding it if it's new
+ *
+ * @param csv_dict Dictionary where to intern the value
+ * @param data     Bytes of the value
+ * @param len      Number of bytes of the value
+ *
+ * @return Code of the value, or @c CSV_DICT_NO_CODE on allocation
+ *         failure
+ */
+uint32_t csv_dict_intern(csv_dict_td *csv_dict, const char *data,
+        size_t len);
+
+/**
+ * @brief Get the code of a value, without adding it
+ *
+ * @param csv_dict Dictionary where to look for the value
+ * @param data     Bytes of the value
+ * @param len      Number of bytes of the value
+ *
+ * @return Code of the value, or @c CSV_DICT_NO_CODE if not found
+ */
+uint32_t csv_dict_find(const csv_dict_td *csv_dict, const char *data,
+        size_t len);
+
+/**
+ * @brief Get the value of a code
+ *
+ * @param csv_dict Dictionary where to get the value from
+ * @param code     Code of the value
+ * @param len      If not @c NULL, set to the length of the value
+ *
+ * @return Null-terminated value, or @c NULL if @p code is unknown
+ */
+const char *csv_dict_value(const csv_dict_td *csv_dict, uint32_t code,
+        size_t *len);
+
+/**
+ * @brief Macro that evaluates to the number of distinct values
+ */
+#define csv_dict_size(dict) ((dict)->num_values)
+
+
+#endif /* ! CSV_DICT_H */
@@ -0,0 +1,119 @@
+/**
+ * @file csvindex.h
+ *
+ * @brief Persistent sidecar row index declaration
+ *
+ * The index of @c file.csv is stored in @c file.csv.idx.  It samples the
+ * position of every @e K-th record, together with the number of lines
+ * before it, so that a parser can jump close to any record and skip at
+ * most @e K - 1 records from there.  The size and modification time of
+ * the CSV file are recorded to tell when the index is stale.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_INDEX_H
+#define CSV_INDEX_H
+
+/* System includes */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+#include <stdint.h>     /* uint64_t, int64_t */
+
+
+/* A record out of this many is sampled */
+#ifndef CSV_INDEX_EVERY
+#define CSV_INDEX_EVERY 1024
+#endif
+
+/* Suffix appended to the name of a CSV file for its index */
+#define CSV_INDEX_SUFFIX ".idx"
+
+
+/**
+ * @typedef csv_index_sample_td
+ *
+ * @brief Structure for the scanner position right before a record
+ */
+typedef struct {
+    uint64_t offset;        /**< Offset where the record (or the blank
+                                 and comment lines before it) starts */
+    uint64_t lines;         /**< Lines before that offset */
+} csv_index_sample_td;
+
+
+/**
+ * @typedef csv_index_td
+ *
+ * @brief Structure for a sidecar row index loaded in memory
+ */
+typedef struct {
+    uint64_t size;                  /**< Size of the indexed file */
+    int64_t mtime_sec;              /**< Modification time (seconds) */
+    int64_t mtime_nsec;             /**< Modification time (nanosecs.) */
+    uint64_t every;                 /**< Records between samples */
+    uint64_t num_records;           /**< Records in the file (header
+                                         included) */
+    char delim;                     /**< Delimiter used to scan */
+    csv_index_sample_td *samples;   /**< Position of every sampled record */
+    size_t num_samples;             /**< Number of samples */
+} csv_index_td;
+
+
+/* Public interface */
+/**
+ * @brief Build the sidecar index of a CSV file
+ *
+ * @param path  Path to the CSV file (a regular file)
+ * @param delim Delimiter between fields
+ *
+ * @return @c true on success, @c false otherwise
+ *
+ * @note The index is written to a temporary file first and renamed, so
+ *       readers never see a partial index.
+ * @note Samples are stored in the byte order of the machine.
+ */
+bool csv_index_build(const char *path, const char *delim);
+
+/**
+ * @brief Load the sidecar index of a CSV file
+ *
+ * @param path  Path to the CSV file
+ * @param delim Delimiter character the index must have been built with
+ *
+ * @return Pointer to the index, or @c NULL if it's missing, corrupt,
+ *         built with another delimiter, or stale (the size or the
+ *         modification time of the CSV file changed)
+ */
+csv_index_td *csv_index_load(const char *path, char delim);
+
+/**
+ * @brief Deallocate an index
+ *
+ * @param index Index to free
+ */
+void csv_index_destroy(csv_index_td *index);
+
+
+#endif /* ! CSV_INDEX_H */
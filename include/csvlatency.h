@@ -0,0 +1,123 @@
+/**
+ * @file csvlatency.h
+ *
+ * @brief Latency histograms declaration
+ *
+ * A histogram counts values (latencies, in nanoseconds) in log-linear
+ * buckets, as HDR histograms do: every power of two is split into
+ * @c CSV_LATENCY_SUB equal buckets, so any value is known within
+ * a relative error of 1 / @c CSV_LATENCY_SUB, with a fixed, small
+ * number of buckets and constant-time recording.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_LATENCY_H
+#define CSV_LATENCY_H
+
+/* System includes */
+#include <stdint.h>     /* uint64_t */
+
+
+/* Bits of the buckets within every power of two, and number of them */
+#define CSV_LATENCY_SUB_BITS 4
+#define CSV_LATENCY_SUB (1 << CSV_LATENCY_SUB_BITS)
+
+/* Highest power of two told apart (2^40 ns. is about 18 minutes) */
+#define CSV_LATENCY_MAX_EXP 40
+
+/* Number of buckets: one linear range, then a range per power of two */
+#define CSV_LATENCY_BUCKETS \
+    ((CSV_LATENCY_MAX_EXP - CSV_LATENCY_SUB_BITS + 2) * CSV_LATENCY_SUB)
+
+
+/**
+ * @typedef csv_latency_td
+ *
+ * @brief Structure for a histogram of latencies
+ */
+typedef struct {
+    uint64_t counts[CSV_LATENCY_BUCKETS];   /**< Values in every bucket */
+    uint64_t count;     /**< Number of values recorded */
+    uint64_t max;       /**< Highest value recorded (exact) */
+} csv_latency_td;
+
+
+/**
+ * @typedef csv_latency_summary_td
+ *
+ * @brief Structure for the usual percentiles of a histogram, in
+ *        nanoseconds
+ */
+typedef struct {
+    uint64_t count;     /**< Number of values recorded */
+    uint64_t p50;       /**< Median */
+    uint64_t p99;       /**< 99th percentile */
+    uint64_t p999;      /**< 99.9th percentile */
+    uint64_t max;       /**< Highest value */
+} csv_latency_summary_td;
+
+
+/* Public interface */
+/**
+ * @brief Remove all the values of a histogram
+ *
+ * @param latency Histogram to reset
+ */
+void csv_latency_reset(csv_latency_td *latency);
+
+/**
+ * @brief Record a value in a histogram
+ *
+ * @param latency Histogram where to record the value
+ * @param value   Value to record, in nanoseconds
+ *
+ * @note Values beyond 2^(@c CSV_LATENCY_MAX_EXP + 1) are counted in the
+ *       last bucket; the maximum is still exact.
+ */
+void csv_latency_record(csv_latency_td *latency, uint64_t value);
+
+/**
+ * @brief Get a percentile of the values of a histogram
+ *
+ * @param latency    Histogram to query
+ * @param percentile Percentile, from @c 0 to @c 100
+ *
+ * @return Highest value of the bucket where the percentile falls (never
+ *         above the maximum), or @c 0 if the histogram is empty
+ */
+uint64_t csv_latency_percentile(const csv_latency_td *latency,
+        double percentile);
+
+/**
+ * @brief Get the usual percentiles of a histogram
+ *
+ * @param latency Histogram to query
+ *
+ * @return Count, p50, p99, p99.9 and maximum of the histogram
+ */
+csv_latency_summary_td csv_latency_summary(const csv_latency_td *latency);
+
+
+#endif /* ! CSV_LATENCY_H */
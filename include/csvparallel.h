@@ -0,0 +1,283 @@
+/**
+ * @file csvparallel.h
+ *
+ * @brief Parallel chunked parsing of a single CSV file declaration
+ *
+ * The file is mapped in memory and split into chunks that start right
+ * after a newline.  Worker threads find the records of every chunk
+ * without knowing whether that newline was inside a quoted field: they
+ * scan the chunk twice, once assuming it wasn't and once assuming it
+ * was, and keep whichever run is consistent with the end of the
+ * previous chunk as soon as that one is known.  Chunks are then parsed
+ * concurrently, and rows are delivered in their original order.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_PARALLEL_H
+#define CSV_PARALLEL_H
+
+/* System includes */
+#include <pthread.h>    /* pthread_t, pthread_mutex_t, pthread_cond_t */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+
+/* Local includes */
+#include <csvparser.h>
+
+
+/* Default size of the chunks of a file */
+#ifndef CSV_PARALLEL_CHUNK
+#define CSV_PARALLEL_CHUNK (4 * 1024 * 1024)
+#endif
+
+
+/**
+ * @typedef csv_chunk_status_td
+ *
+ * @brief Progress of a chunk through the workers and the consumer
+ */
+typedef enum {
+    CSV_CHUNK_FREE,         /**< Slot available for a new chunk */
+    CSV_CHUNK_SCANNING,     /**< Records being located */
+    CSV_CHUNK_SCANNED,      /**< Records located, start state unknown */
+    CSV_CHUNK_RESOLVED,     /**< Start state known, waiting to be parsed */
+    CSV_CHUNK_PARSING,      /**< Records being split into fields */
+    CSV_CHUNK_READY         /**< Rows ready for the consumer */
+} csv_chunk_status_td;
+
+
+/**
+ * @typedef csv_chunk_td
+ *
+ * @brief Structure for a chunk of the file
+ *
+ * Arrays indexed by @c [2] hold the speculative scans: index 0 assumes
+ * the chunk starts between records, index 1 that it starts inside
+ * a quoted field.
+ */
+typedef struct {
+    size_t seq;                     /**< Position of the chunk in the file */
+    size_t begin;                   /**< Offset of the first byte */
+    size_t end;                     /**< Offset past the last byte */
+    csv_chunk_status_td status;     /**< Progress of the chunk */
+    bool scanned[2];                /**< Which speculative scans were run */
+    csv_span_td *spans[2];          /**< Records found by each scan */
+    size_t num_spans[2];            /**< Number of records found */
+    size_t spans_cap[2];            /**< Capacity of @e spans */
+    csv_scan_state_td end_state[2]; /**< State at the end of each scan */
+    size_t tail_start[2];           /**< Start of the unfinished record */
+    int sel;                        /**< Scan kept after resolution */
+    size_t carry_start;             /**< Start of a record that began in
+                                         an earlier chunk (if @e sel 1) */
+    char *arena;                    /**< Unescaped fields of the chunk */
+    size_t arena_cap;               /**< Capacity of @e arena */
+    csv_field_td *fields;           /**< Fields of every record */
+    size_t fields_cap;              /**< Capacity of @e fields */
+    size_t *first_field;            /**< First field of every record, plus
+                                         one past the last one */
+    size_t records_cap;             /**< Capacity of @e first_field */
+    size_t num_records;             /**< Number of records parsed */
+} csv_chunk_td;
+
+
+/**
+ * @typedef csv_parallel_td
+ *
+ * @brief Structure for the parallel CSV parser
+ */
+typedef struct {
+    int fd;                     /**< File descriptor */
+    const char *data;           /**< Contents of the file (mapped) */
+    size_t size;                /**< Size of the file */
+    char delim;                 /**< Delimiter between fields */
+    bool has_header;            /**< If true, first record is header */
+    csv_row_td *header;         /**< Header, if any */
+    size_t chunk_size;          /**< Nominal size of a chunk */
+    pthread_t *threads;         /**< Worker threads */
+    size_t num_threads;         /**< Number of worker threads */
+    pthread_mutex_t lock;       /**< Protects everything below */
+    pthread_cond_t work_cond;   /**< Signalled when workers may proceed */
+    pthread_cond_t ready_cond;  /**< Signalled when a chunk is ready */
+    csv_chunk_td *chunks;       /**< Ring of chunks in flight */
+    size_t window;              /**< Number of chunks in flight */
+    size_t next_begin;          /**< Offset of the next chunk to create */
+    size_t next_seq;            /**< Position of the next chunk to create */
+    size_t resolved_seq;        /**< Chunks before this one are resolved */
+    csv_scan_state_td resolve_state; /**< State at the start of it */
+    size_t resolve_carry;       /**< Start of the record it continues */
+    size_t consume_seq;         /**< Chunk being consumed */
+    csv_chunk_td *current;      /**< That chunk, once ready, or @c NULL */
+    size_t consume_rec;         /**< Next record of that chunk */
+    bool stop;                  /**< Workers have to finish */
+    bool failed;                /**< A worker ran out of memory */
+    csv_row_view_td view;       /**< Row returned to the consumer */
+} csv_parallel_td;
+
+
+/**
+ * @typedef csv_record_index_td
+ *
+ * @brief Structure for the location of every record of a buffer
+ *
+ * Spans follow @a csv_scan(): a trailing carriage return is included,
+ * and the line feed that ends the record is not.
+ */
+typedef struct {
+    csv_span_td *records;   /**< Records, in order */
+    size_t num_records;     /**< Number of records */
+    size_t cap;             /**< Capacity of @e records */
+} csv_record_index_td;
+
+
+/* Public interface */
+/**
+ * @brief Get the number of online processors
+ *
+ * @return Number of online processors, or @c 1 if unknown
+ */
+size_t csv_parallel_num_cpus(void);
+
+/**
+ * @brief Initialize an empty record index
+ *
+ * @param index Record index to initialize
+ */
+void csv_record_index_init(csv_record_index_td *index);
+
+/**
+ * @brief Deallocate the records of a record index
+ *
+ * @param index Record index to free
+ */
+void csv_record_index_destroy(csv_record_index_td *index);
+
+/**
+ * @brief Locate every record of a buffer using several threads
+ *
+ * The buffer is cut into one chunk per thread.  A first parallel pass
+ * finds, for each chunk, the scanner state at its end for both possible
+ * start states (between records, or inside a quoted field).  A short
+ * sequential step chains those carries to learn the real start state of
+ * every chunk, and a second parallel pass records the spans.
+ *
+ * @param index       Record index to fill; its previous contents are
+ *                    replaced, and its memory is reused
+ * @param data        Buffer with the CSV data
+ * @param begin       Offset of the first record (e.g., after the header)
+ * @param size        Size of the buffer
+ * @param delim       Delimiter between fields
+ * @param num_threads Number of threads, or @c 0 to use one per online
+ *                    processor
+ *
+ * @return @c true on success, @c false on allocation failure
+ *
+ * @note Quoted fields may span lines; comments and blank lines are not
+ *       indexed, as in @a csv_scan().
+ */
+bool csv_record_index_build(csv_record_index_td *index, const char *data,
+        size_t begin, size_t size, char delim, size_t num_threads);
+
+/**
+ * @brief Count the records of a CSV file without parsing them
+ *
+ * Uses the first pass of @a csv_record_index_build() only: each thread
+ * counts the records of its chunk for both possible start states, and
+ * the counts that match the chained carries are added up.  No row is
+ * materialized and nothing is allocated per record.
+ *
+ * @param path        Path to the CSV file (a regular file)
+ * @param delim       Delimiter between fields
+ * @param has_header  If @c true, the header isn't counted
+ * @param num_threads Number of threads, or @c 0 to use one per online
+ *                    processor
+ * @param count       Where to store the number of records
+ *
+ * @return @c true on success, @c false otherwise
+ *
+ * @note Blank and comment lines aren't counted, and quoted fields may
+ *       span lines, as in @a csv_parser_row().
+ */
+bool csv_count_records(const char *path, const char *delim, bool has_header,
+        size_t num_threads, size_t *count);
+
+/**
+ * @brief Initialize the parallel CSV parser and start its workers
+ *
+ * @param filename    Path to the CSV data file (a regular file)
+ * @param delim       Delimiter between fields
+ * @param has_header  If @c true, the first record is the header
+ * @param num_threads Number of worker threads, or @c 0 to use one per
+ *                    online processor
+ *
+ * @return Pointer to the parallel parser, or @c NULL otherwise
+ *
+ * @note Follows the same grammar as @a csv_parser_init().
+ */
+csv_parallel_td *csv_parallel_init(const char *filename, const char *delim,
+        bool has_header, size_t num_threads);
+
+/**
+ * @brief Stop the workers and deallocate the parallel CSV parser
+ *
+ * @param csv_parallel Parallel CSV parser to free
+ */
+void csv_parallel_destroy(csv_parallel_td *csv_parallel);
+
+/**
+ * @brief Get the header of the CSV file, if any
+ *
+ * @param csv_parallel Parallel CSV parser to get its header from
+ *
+ * @return Header of the CSV file, or @c NULL otherwise
+ */
+const csv_row_td *csv_parallel_header(csv_parallel_td *csv_parallel);
+
+/**
+ * @brief Get the next row without copying its fields
+ *
+ * @param csv_parallel Parallel CSV parser where to get the row from
+ *
+ * @return Pointer to the next row view, in file order, or @c NULL on
+ *         EOF or error
+ *
+ * @note The fields are valid until the next call.
+ */
+const csv_row_view_td *csv_parallel_row_view(csv_parallel_td *csv_parallel);
+
+/**
+ * @brief Get the next row
+ *
+ * @param csv_parallel Parallel CSV parser where to get the row from
+ *
+ * @return Pointer to the next row, in file order, or @c NULL on EOF or
+ *         error
+ *
+ * @note The row is copied from @a csv_parallel_row_view() by the calling
+ *       thread, and must be freed with @a csv_parser_destroy_row().
+ */
+csv_row_td *csv_parallel_row(csv_parallel_td *csv_parallel);
+
+
+#endif /* ! CSV_PARALLEL_H */
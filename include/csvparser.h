@@ -61,7 +61,14 @@
 
 /* System includes */
 #include <stdbool.h>    /* bool, true */
+#include <stdint.h>     /* uint64_t */
 #include <stdio.h>      /* FILE */
+#include <sys/types.h>  /* off_t */
+
+/* Local includes */
+#include <csvcache.h>
+#include <csvindex.h>
+#include <csvlatency.h>
 
 
 #define CSV_HAS_HEADER (true)
@@ -72,6 +79,8 @@
 #define CSV_DELIM_TAB "\t"
 #define CSV_DELIM_PIPE "|"
 
+#define CSV_NO_COLUMN ((size_t) -1)
+
 
 /**
  * @typedef csv_row_td
@@ -84,6 +93,155 @@ typedef struct {
 } csv_row_td;
 
 
+/**
+ * @typedef csv_field_td
+ *
+ * @brief Structure for a field slice that is not owned by the caller
+ */
+typedef struct {
+    const char *data;   /**< Unescaped, null-terminated field contents */
+    size_t len;         /**< Length of the field, in bytes */
+} csv_field_td;
+
+
+/**
+ * @typedef csv_row_view_td
+ *
+ * @brief Structure for a row whose fields point into the parser buffer
+ */
+typedef struct {
+    csv_field_td *fields;   /**< Field slices in this CSV row */
+    size_t num_fields;      /**< Number of fields in this CSV row */
+} csv_row_view_td;
+
+
+/**
+ * @typedef csv_scan_state_td
+ *
+ * @brief State of a record scanner after the last byte scanned
+ */
+typedef enum {
+    CSV_SCAN_LINE_START,        /**< At the start of a line, no record */
+    CSV_SCAN_BLANK,             /**< Only whitespace so far in the line */
+    CSV_SCAN_BLANK_DELIM,       /**< Ditto, and the last was a delimiter */
+    CSV_SCAN_COMMENT,           /**< In a comment or skippable line */
+    CSV_SCAN_FIELD_START,       /**< At the start of a field */
+    CSV_SCAN_UNQUOTED,          /**< In an unquoted field */
+    CSV_SCAN_QUOTED,            /**< In a quoted field */
+    CSV_SCAN_QUOTE_IN_QUOTED    /**< After a quote in a quoted field */
+} csv_scan_state_td;
+
+
+/**
+ * @typedef csv_span_td
+ *
+ * @brief Structure for the position of a record in a buffer
+ */
+typedef struct {
+    size_t start;       /**< Position of the first byte of the record */
+    size_t end;         /**< Position of its newline (not included) */
+} csv_span_td;
+
+
+/**
+ * @typedef csv_scan_td
+ *
+ * @brief Structure for a resumable, quote-aware record scanner
+ *
+ * Positions are relative to the buffer given to @a csv_scan(); when the
+ * caller moves the bytes of its buffer, it has to move them as well.
+ */
+typedef struct {
+    csv_scan_state_td state;    /**< State after the last byte scanned */
+    char delim;                 /**< Delimiter between fields */
+    size_t pos;                 /**< Position of the next byte to scan */
+    size_t start;               /**< Start of the current record/line */
+    size_t line_start;          /**< Start of the current physical line */
+    size_t lines;               /**< Number of physical lines scanned */
+    size_t skipped;             /**< Blank and comment lines among them
+                                     (only counted with CSV_STATS) */
+} csv_scan_td;
+
+
+/**
+ * @typedef csv_raw_td
+ *
+ * @brief Structure for the bytes of the current record as read, kept
+ *        for passthrough
+ */
+typedef struct {
+    bool keep;              /**< Whether records are kept */
+    bool valid;             /**< Whether @e data holds the current one */
+    char *data;             /**< Bytes of the record, without newline
+                                 (but with the CR of a CRLF) */
+    size_t len;             /**< Number of bytes of the record */
+    size_t cap;             /**< Capacity of @e data */
+    csv_span_td *fields;    /**< Bytes of every field in @e data */
+    size_t num_fields;      /**< Number of fields in @e fields */
+    size_t fields_cap;      /**< Capacity of @e fields */
+    bool split;             /**< Whether @e fields is up to date */
+    bool open_quote;        /**< Whether the last field is quoted but
+                                 never closed */
+} csv_raw_td;
+
+
+/**
+ * @typedef csv_header_index_td
+ *
+ * @brief Structure for a perfect hash from header names to columns
+ *
+ * Built with the "hash and displace" method: the hash of a name selects
+ * a bucket, and the displacement of that bucket, combined with the same
+ * hash, selects a slot that no other name of the header uses.
+ */
+typedef struct {
+    size_t *slots;          /**< Column of every slot, or CSV_NO_COLUMN */
+    size_t num_slots;       /**< Number of slots (power of two) */
+    size_t *disp;           /**< Displacement of every bucket */
+    size_t num_buckets;     /**< Number of buckets */
+} csv_header_index_td;
+
+
+/**
+ * @typedef csv_stats_td
+ *
+ * @brief Structure for the counters of a parser
+ *
+ * They're only kept when the library is built with @c CSV_STATS
+ * defined; otherwise, the code updating them isn't even compiled.
+ */
+typedef struct {
+    uint64_t bytes_read;    /**< Bytes read from the file */
+    size_t lines;           /**< Physical lines before the position */
+    size_t records;         /**< Records read or skipped (and header) */
+    size_t fields;          /**< Fields split */
+    size_t quoted_fields;   /**< Quoted fields among them */
+    size_t escaped_quotes;  /**< Doubled quotes inside quoted fields */
+    size_t skipped_lines;   /**< Blank and comment lines skipped */
+    size_t allocs;          /**< Memory allocations while parsing */
+    uint64_t alloc_bytes;   /**< Bytes requested by those allocations */
+    size_t buf_grows;       /**< Times the read buffer was grown */
+    uint64_t io_ns;         /**< Time spent reading, in nanoseconds */
+    uint64_t parse_ns;      /**< Time spent scanning and splitting */
+} csv_stats_td;
+
+
+/**
+ * @typedef csv_latency_class_td
+ *
+ * @brief Classes of calls whose latencies are told apart, by the size
+ *        of the record they return
+ */
+typedef enum {
+    CSV_LATENCY_ALL,            /**< Every call, EOF included */
+    CSV_LATENCY_SMALL,          /**< Records up to 256 bytes */
+    CSV_LATENCY_MEDIUM,         /**< Records up to 4 KiB */
+    CSV_LATENCY_LARGE,          /**< Records up to 64 KiB */
+    CSV_LATENCY_HUGE,           /**< Larger records */
+    CSV_LATENCY_CLASSES         /**< Number of classes */
+} csv_latency_class_td;
+
+
 /**
  * @typedef csv_parser_td
  *
@@ -96,10 +254,75 @@ typedef struct {
     bool has_header;        /**< If true, first line is header */
     size_t line_no;         /**< Line number being processed */
     csv_row_td *header;     /**< Header string */
+    csv_header_index_td *header_index;  /**< Header names lookup */
+    char *buf;              /**< Read buffer */
+    size_t buf_cap;         /**< Capacity of the read buffer */
+    size_t buf_len;         /**< Number of bytes in the read buffer */
+    off_t buf_offset;       /**< File offset of the read buffer */
+    csv_scan_td scan;       /**< Record scanner over the read buffer */
+    csv_row_view_td view;   /**< Fields of the current record */
+    size_t view_cap;        /**< Capacity of the view fields array */
+    csv_index_td *row_index;    /**< Sidecar row index, if any */
+    bool row_index_loaded;  /**< Whether loading it was attempted */
+    csv_cache_td *cache;    /**< Parse cache of the file, if any */
+    size_t cache_pos;       /**< Next record to read from the cache */
+    bool cache_active;      /**< Whether records are read from it */
+    off_t record_offset;    /**< File offset of the last record read */
+    uint64_t record_hash;   /**< Hash of its bytes, up to the scan
+                                 position, taken at EOF */
+    bool record_hashed;     /**< Whether that hash was taken */
+    off_t record_hash_end;  /**< File offset right after the last
+                                 record read, or -1 if it's unknown */
+    off_t record_end;       /**< File offset right after the current
+                                 record, or -1 if there's none */
+    bool record_newline;    /**< Whether a newline terminates it */
+    bool follow;            /**< Whether to wait for appended records */
+    int follow_timeout;     /**< Time to wait for them (ms.), or -1 */
+    int follow_fd;          /**< inotify descriptor, or -1 */
+    csv_stats_td stats;     /**< Counters (with CSV_STATS only) */
+    uint64_t stats_mark;    /**< Time of the last timing mark (ns.) */
+    csv_latency_td *latency;    /**< Histogram of every latency class,
+                                     or @c NULL if not recorded */
+    csv_raw_td raw;         /**< Current record as read */
 } csv_parser_td;
 
 
+/**
+ * @typedef csv_refresh_td
+ *
+ * @brief Outcome of refreshing a parser
+ */
+typedef enum {
+    CSV_REFRESH_ERROR = -1,     /**< The file couldn't be checked */
+    CSV_REFRESH_UNCHANGED,      /**< Nothing was appended */
+    CSV_REFRESH_APPENDED,       /**< New records may follow */
+    CSV_REFRESH_RESET           /**< The file was truncated or rewritten;
+                                     parsing starts over */
+} csv_refresh_td;
+
+
+/**
+ * @typedef csv_checkpoint_td
+ *
+ * @brief Structure for a position where parsing can be resumed
+ */
+typedef struct {
+    off_t offset;           /**< File offset right after a record */
+    size_t line_no;         /**< Lines before @e offset */
+} csv_checkpoint_td;
+
+
 /* Public interface */
+/**
+ * @brief Get the delimiter character a parser uses for a given string
+ *
+ * @param delim Delimiter between fields
+ *
+ * @return First character of @p delim, or @c ',' if @p delim is
+ *         @c '\n', @c '\r', @c '"', empty or @c NULL
+ */
+char csv_parser_delim(const char *delim);
+
 /**
  * @brief Initialize the CSV parser
  *
@@ -138,6 +361,21 @@ void csv_parser_destroy_row(csv_row_td *csv_row);
  */
 const csv_row_td *csv_parser_header(csv_parser_td *csv_parser);
 
+/**
+ * @brief Get the index of a column from its name in the header
+ *
+ * @param csv_parser CSV parser whose header is used
+ * @param name       Null-terminated name of the column
+ *
+ * @return Index of the column, or @c CSV_NO_COLUMN if there's no header
+ *         or no column is named @p name
+ *
+ * @note If several columns have the same name, the first one is found.
+ * @note The lookup takes constant time: a perfect hash of the header
+ *       names is built once, right after the header is read.
+ */
+size_t csv_parser_column_index(csv_parser_td *csv_parser, const char *name);
+
 /**
  * @brief Get the current row that it's being parsed
  *
@@ -147,6 +385,369 @@ const csv_row_td *csv_parser_header(csv_parser_td *csv_parser);
  */
 csv_row_td *csv_parser_row(csv_parser_td *csv_parser);
 
+/**
+ * @brief Skip records without splitting them into fields
+ *
+ * Only record terminators are looked for (honoring quoted fields, blank
+ * lines and comments), so no row is built and no field is unescaped.
+ *
+ * @param csv_parser CSV parser where to skip the records
+ * @param n          Number of records to skip (the header, if any, isn't
+ *                   counted)
+ *
+ * @return Number of records skipped, less than @p n only at EOF or on
+ *         error
+ *
+ * @note The line number is kept accurate.
+ */
+size_t csv_parser_skip(csv_parser_td *csv_parser, size_t n);
+
+/**
+ * @brief Follow the file as it's appended to, or stop following it
+ *
+ * While following, reaching the end of the file waits for more data
+ * (through inotify where available, checking periodically otherwise)
+ * instead of ending, and a record without its final newline is never
+ * returned, since its writer may not be done with it.  The read buffer
+ * and the file position are kept: only appended bytes are read.
+ *
+ * @param csv_parser CSV parser to follow the file with
+ * @param follow     Whether to follow the file
+ * @param timeout_ms Maximum time to wait for a record, in milliseconds,
+ *                   or @c -1 to wait forever
+ *
+ * @return @c true on success, @c false otherwise
+ *
+ * @note When the time runs out, or the file is removed or renamed, the
+ *       functions reading rows return @c NULL; they can be called again
+ *       to keep following.
+ */
+bool csv_parser_follow(csv_parser_td *csv_parser, bool follow,
+        int timeout_ms);
+
+/**
+ * @brief Get the counters of a parser
+ *
+ * @param csv_parser CSV parser to query
+ * @param stats      Where to store the counters
+ *
+ * @return @c true on success, @c false on error or if the library was
+ *         built without @c CSV_STATS (then @p stats is zeroed)
+ *
+ * @note Parsing time excludes the time spent reading, and waiting for
+ *       appended data in follow mode.
+ */
+bool csv_parser_stats(const csv_parser_td *csv_parser, csv_stats_td *stats);
+
+/**
+ * @brief Read the records from the parse cache of the file
+ *
+ * The cache is loaded if it's up to date, or built first (a full pass
+ * over the file) otherwise; from then on, rows are read from it without
+ * scanning or splitting them, starting with the record the parser is
+ * at.
+ *
+ * @param csv_parser CSV parser to read through the cache
+ * @param dir        Directory of the cache, or @c NULL for a cache next
+ *                   to the CSV file (see @a csv_cache_build())
+ *
+ * @return @c true on success, @c false if the cache can't be used
+ *         (then records are still read from the file)
+ *
+ * @note Keeping records as read, following the file, refreshing it,
+ *       or resuming at a checkpoint go on from the file instead.
+ */
+bool csv_parser_cache(csv_parser_td *csv_parser, const char *dir);
+
+/**
+ * @brief Start or stop keeping every record as read
+ *
+ * While kept, the bytes of the current record, as they are in the
+ * file, and those of each of its fields (quotes and doubled quotes
+ * included) can be copied straight to a @e csv_writer_td, so that
+ * unchanged records and fields aren't unescaped and quoted again.
+ *
+ * @param csv_parser CSV parser whose records to keep
+ * @param keep       Whether to keep them
+ *
+ * @return @c true on success, @c false on error
+ *
+ * @note It costs a copy of every record read.
+ */
+bool csv_parser_keep_raw(csv_parser_td *csv_parser, bool keep);
+
+/**
+ * @brief Get the current record as read
+ *
+ * @param csv_parser CSV parser to query
+ * @param len        Where to store the number of bytes of the record
+ *
+ * @return Pointer to the bytes of the record (without its newline, but
+ *         with the carriage return of a CRLF; valid until the next
+ *         record is read), or @c NULL if records aren't kept, or if
+ *         there's no current record
+ */
+const char *csv_parser_raw_record(csv_parser_td *csv_parser,
+        size_t *len);
+
+/**
+ * @brief Get a field of the current record as read
+ *
+ * @param csv_parser CSV parser to query
+ * @param index      Index of the field, as in the row view
+ * @param len        Where to store the number of bytes of the field
+ *
+ * @return Pointer to the bytes of the field (quoted, if it was), or
+ *         @c NULL if records aren't kept, there's no current record, or
+ *         @p index is out of bounds
+ */
+const char *csv_parser_raw_field(csv_parser_td *csv_parser, size_t index,
+        size_t *len);
+
+/**
+ * @brief Start or stop recording the latency of every row call
+ *
+ * Once started, every call to @a csv_parser_row() and
+ * @a csv_parser_row_view() is timed, from entry to return (reading
+ * included), and counted in the histogram of all calls and in the one
+ * of the size class of the record returned.
+ *
+ * @param csv_parser CSV parser whose calls to time
+ * @param enable     Whether to record latencies; stopping discards the
+ *                   histograms
+ *
+ * @return @c true on success, @c false on error
+ */
+bool csv_parser_latency(csv_parser_td *csv_parser, bool enable);
+
+/**
+ * @brief Get the latency histogram of a class of calls
+ *
+ * @param csv_parser  CSV parser to query
+ * @param latency_cls Class of calls
+ *
+ * @return Pointer to the histogram (owned by the parser), or @c NULL if
+ *         latencies aren't being recorded
+ *
+ * @note Use @a csv_latency_summary() to get p50, p99, p99.9 and max.
+ */
+const csv_latency_td *csv_parser_latency_histogram(
+        const csv_parser_td *csv_parser, csv_latency_class_td latency_cls);
+
+/**
+ * @brief Remove all the values of the latency histograms of a parser
+ *
+ * @param csv_parser CSV parser whose histograms to reset
+ */
+void csv_parser_latency_reset(csv_parser_td *csv_parser);
+
+/**
+ * @brief Continue parsing what was appended since the end was reached
+ *
+ * Checks that the file wasn't replaced or truncated, and that the last
+ * record read still hashes the same; if so, parsing resumes right after
+ * it, reading only the appended bytes.  Otherwise, the file is
+ * reopened and parsing starts over, header included.
+ *
+ * @param csv_parser CSV parser to refresh
+ *
+ * @return Outcome of the refresh
+ *
+ * @note A last record without its final newline was taken as complete
+ *       at EOF; if the bytes appended go on with it, it's read again
+ *       whole, so the rows that follow are those of a full parse.
+ */
+csv_refresh_td csv_parser_refresh(csv_parser_td *csv_parser);
+
+/**
+ * @brief Get the file offset of the last record read
+ *
+ * @param csv_parser CSV parser to query
+ *
+ * @return Offset where the last record read (or the header) starts
+ */
+off_t csv_parser_offset(const csv_parser_td *csv_parser);
+
+/**
+ * @brief Get the bytes of the file taken by the current record
+ *
+ * @param csv_parser CSV parser to query
+ * @param offset     Where to store the offset where the record starts
+ * @param len        Where to store its number of bytes, including its
+ *                   line terminator
+ * @param newline    Where to store whether it ends with a newline (the
+ *                   last one of the file may not), or @c NULL
+ *
+ * @return @c true on success, @c false if there's no current record
+ *         (none read yet, or records were skipped since)
+ */
+bool csv_parser_record_span(const csv_parser_td *csv_parser,
+        off_t *offset, size_t *len, bool *newline);
+
+/**
+ * @brief Get the position where to resume parsing after the last record
+ *        read
+ *
+ * @param csv_parser CSV parser to query
+ *
+ * @return Checkpoint for @a csv_parser_resume(); its offset is @c -1 if
+ *         @p csv_parser is @c NULL
+ *
+ * @note Persist it only after the last record read has been fully
+ *       processed; resuming there continues with the next record.
+ */
+csv_checkpoint_td csv_parser_checkpoint(const csv_parser_td *csv_parser);
+
+/**
+ * @brief Resume parsing at a checkpoint
+ *
+ * The file is reopened at @p offset without reading anything before it.
+ *
+ * @param csv_parser CSV parser to move
+ * @param offset     Offset of the checkpoint
+ * @param line_no    Line number of the checkpoint
+ * @param header     Header to use (it's copied), or @c NULL to read it
+ *                   from the start of the file; ignored if the parser
+ *                   has no header
+ *
+ * @return @c true on success, @c false otherwise
+ *
+ * @note A checkpoint at offset @c 0 (taken before reading anything)
+ *       starts over, reading the header from the file.
+ */
+bool csv_parser_resume(csv_parser_td *csv_parser, off_t offset,
+        size_t line_no, const csv_row_td *header);
+
+/**
+ * @brief Move the parser to a row, so that it's the next one read
+ *
+ * @param csv_parser CSV parser to move
+ * @param n          Number of the row, from @c 0 (the header, if any,
+ *                   isn't counted)
+ *
+ * @return @c true on success, @c false if there's no such row or on
+ *         error
+ *
+ * @note Uses the sidecar index of the file (see @a csv_index_build())
+ *       to skip at most @c CSV_INDEX_EVERY - 1 records.  Without a valid
+ *       index, it skips every record from the start of the file.
+ * @note Skipped records are located but not split into fields, and the
+ *       line number stays accurate.
+ */
+bool csv_parser_seek_row(csv_parser_td *csv_parser, size_t n);
+
+/**
+ * @brief Get the current row without copying its fields
+ *
+ * @param csv_parser CSV parser where to get the row from
+ *
+ * @return Pointer to the current row view, or @c NULL on EOF or error
+ *
+ * @note The fields point into a buffer owned by the parser; they are
+ *       valid until the next call that reads from @p csv_parser.
+ */
+const csv_row_view_td *csv_parser_row_view(csv_parser_td *csv_parser);
+
+/**
+ * @brief Get a field of a row
+ *
+ * @param csv_row Row where to get the field from
+ * @param index   Index of the field, e.g. from @a csv_parser_column_index()
+ *
+ * @return Contents of the field, or @c NULL if @p index is out of bounds
+ */
+const char *csv_row_get(const csv_row_td *csv_row, size_t index);
+
+/**
+ * @brief Get a field of a row view
+ *
+ * @param view  Row view where to get the field from
+ * @param index Index of the field, e.g. from @a csv_parser_column_index()
+ *
+ * @return Field slice, or @c NULL if @p index is out of bounds
+ */
+const csv_field_td *csv_row_view_get(const csv_row_view_td *view,
+        size_t index);
+
+/**
+ * @brief Initialize a record scanner
+ *
+ * @param scan  Scanner to initialize
+ * @param delim Delimiter between fields
+ * @param state Initial state; @c CSV_SCAN_LINE_START at the start of
+ *              a file, or @c CSV_SCAN_QUOTED to resume after a newline
+ *              that is inside a quoted field
+ * @param pos   Position of the first byte to scan
+ */
+void csv_scan_init(csv_scan_td *scan, char delim, csv_scan_state_td state,
+        size_t pos);
+
+/**
+ * @brief Scan bytes looking for the ends of records
+ *
+ * Follows the same grammar as the parser: blank lines and comments are
+ * skipped, and newlines inside quoted fields don't end records.
+ *
+ * @param scan      Scanner; scanning resumes at @e scan->pos
+ * @param buf       Buffer to scan
+ * @param end       Position where to stop scanning
+ * @param spans     Where to store the records found, or @c NULL to just
+ *                  count them
+ * @param max_spans Stop after finding this many records
+ *
+ * @return Number of records found
+ *
+ * @note A record that started before @e scan->pos (or before the first
+ *       byte scanned) reports its start as @e scan->start had it.
+ */
+size_t csv_scan(csv_scan_td *scan, const char *buf, size_t end,
+        csv_span_td *spans, size_t max_spans);
+
+/**
+ * @brief Finish scanning at the end of the data
+ *
+ * @param scan Scanner to finish
+ * @param span Where to store the last record, if any
+ *
+ * @return @c true if a record without a final newline was pending
+ */
+bool csv_scan_flush(csv_scan_td *scan, csv_span_td *span);
+
+/**
+ * @brief Move a scanner back after discarding the start of its buffer
+ *
+ * @param scan  Scanner to adjust
+ * @param shift Number of bytes removed from the start of the buffer; it
+ *              can't be greater than @e scan->start
+ */
+void csv_scan_shift(csv_scan_td *scan, size_t shift);
+
+/**
+ * @brief Split a record into field slices, in place
+ *
+ * @param record   Null-terminated record (no trailing newline); its
+ *                 contents are overwritten with the unescaped fields
+ * @param delim    Delimiter between fields
+ * @param view     Row view to fill with slices pointing into @p record
+ * @param view_cap Pointer to the capacity of @e view->fields (0 if
+ *                 @e view->fields is @c NULL)
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+bool csv_split_record(char *record, char delim, csv_row_view_td *view,
+        size_t *view_cap);
+
+/**
+ * @brief Copy a row view into a newly allocated row
+ *
+ * @param view Row view to copy
+ *
+ * @return Pointer to the new row, or @c NULL otherwise
+ *
+ * @note The row must be freed with @a csv_parser_destroy_row().
+ */
+csv_row_td *csv_row_from_view(const csv_row_view_td *view);
+
 /**
  * @brief Macro that evaluates to the CSV fields
  */
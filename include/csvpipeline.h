@@ -0,0 +1,246 @@
+/**
+ * @file csvpipeline.h
+ *
+ * @brief Reader, parsers and consumer pipeline declaration
+ *
+ * A reader thread fills raw blocks that end at a record boundary,
+ * parser threads split the records of each block into fields, and the
+ * consumer takes the rows back in their original order.  The stages
+ * are connected by bounded lock-free rings, so a slow stage makes the
+ * others wait instead of queueing an unbounded amount of data.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_PIPELINE_H
+#define CSV_PIPELINE_H
+
+/* System includes */
+#include <pthread.h>    /* pthread_t */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+
+/* Local includes */
+#include <csvparser.h>
+
+
+/* Default size of the blocks read */
+#ifndef CSV_PIPELINE_BLOCK
+#define CSV_PIPELINE_BLOCK (1024 * 1024)
+#endif
+
+/* Size of a cache line, to keep the ends of a ring apart */
+#define CSV_CACHE_LINE 64
+
+
+/**
+ * @typedef csv_ring_cell_td
+ *
+ * @brief Structure for a cell of a ring
+ */
+typedef struct {
+    size_t seq;     /**< Turn of the cell */
+    void *item;     /**< Item stored */
+} csv_ring_cell_td;
+
+
+/**
+ * @typedef csv_ring_td
+ *
+ * @brief Structure for a bounded lock-free ring of pointers
+ *
+ * Every cell has a turn that tells producers and consumers whether it's
+ * theirs, so any number of each may use the ring concurrently.
+ */
+typedef struct {
+    csv_ring_cell_td *cells;    /**< Cells of the ring */
+    size_t mask;                /**< Capacity minus one */
+    char pad0[CSV_CACHE_LINE];  /**< Keeps the indices apart */
+    size_t head;                /**< Next cell to pop */
+    char pad1[CSV_CACHE_LINE];  /**< Keeps the indices apart */
+    size_t tail;                /**< Next cell to push */
+    char pad2[CSV_CACHE_LINE];  /**< Keeps the indices apart */
+} csv_ring_td;
+
+
+/**
+ * @typedef csv_block_td
+ *
+ * @brief Structure for a block of whole records flowing through the
+ *        pipeline
+ */
+typedef struct {
+    char *data;                 /**< Raw records, split in place */
+    size_t len;                 /**< Number of bytes read */
+    size_t cap;                 /**< Capacity of @e data */
+    csv_span_td *spans;         /**< Records of the block */
+    size_t num_spans;           /**< Number of records */
+    size_t spans_cap;           /**< Capacity of @e spans */
+    csv_field_td *fields;       /**< Fields of every record */
+    size_t fields_cap;          /**< Capacity of @e fields */
+    size_t *first_field;        /**< First field of every record, plus
+                                     one past the last one */
+    size_t records_cap;         /**< Capacity of @e first_field */
+    csv_row_view_td view;       /**< Scratch view for the parser */
+    size_t view_cap;            /**< Capacity of @e view */
+    int ready;                  /**< Set once the block is parsed */
+} csv_block_td;
+
+
+/**
+ * @typedef csv_pipeline_td
+ *
+ * @brief Structure for the pipelined CSV parser
+ */
+typedef struct {
+    int fd;                     /**< File descriptor being read */
+    char delim;                 /**< Delimiter between fields */
+    bool has_header;            /**< If true, first record is header */
+    csv_row_td *header;         /**< Header, if any */
+    size_t block_size;          /**< Nominal size of a block */
+    csv_block_td *blocks;       /**< Every block */
+    size_t num_blocks;          /**< Number of blocks */
+    csv_ring_td free_ring;      /**< Consumer to reader: empty blocks */
+    csv_ring_td work_ring;      /**< Reader to parsers: blocks to parse */
+    csv_ring_td order_ring;     /**< Reader to consumer: blocks in order */
+    pthread_t reader;           /**< Reader thread */
+    bool reader_started;        /**< Whether the reader was created */
+    pthread_t *parsers;         /**< Parser threads */
+    size_t num_parsers;         /**< Number of parser threads */
+    csv_block_td *current;      /**< Block being consumed, or @c NULL */
+    size_t consume_rec;         /**< Next record of that block */
+    bool started;               /**< Whether the first block was taken */
+    int done;                   /**< Set when the reader is finished */
+    int failed;                 /**< Set on read or allocation errors */
+    int stop;                   /**< Set when threads have to finish */
+    csv_row_view_td view;       /**< Row returned to the consumer */
+} csv_pipeline_td;
+
+
+/* Public interface */
+/**
+ * @brief Initialize a ring
+ *
+ * @param ring Ring to initialize
+ * @param cap  Capacity of the ring; must be a power of two
+ *
+ * @return @c true on success, @c false otherwise
+ */
+bool csv_ring_init(csv_ring_td *ring, size_t cap);
+
+/**
+ * @brief Deallocate the cells of a ring
+ *
+ * @param ring Ring to free
+ */
+void csv_ring_destroy(csv_ring_td *ring);
+
+/**
+ * @brief Add an item to a ring, without waiting
+ *
+ * @param ring Ring where to add the item
+ * @param item Item to add
+ *
+ * @return @c true on success, @c false if the ring is full
+ */
+bool csv_ring_push(csv_ring_td *ring, void *item);
+
+/**
+ * @brief Remove the oldest item of a ring, without waiting
+ *
+ * @param ring Ring where to remove the item from
+ *
+ * @return Item removed, or @c NULL if the ring is empty
+ */
+void *csv_ring_pop(csv_ring_td *ring);
+
+/**
+ * @brief Initialize the pipelined CSV parser and start its threads
+ *
+ * @param filename    Path to the CSV data file (it may be a pipe)
+ * @param delim       Delimiter between fields
+ * @param has_header  If @c true, the first record is the header
+ * @param num_parsers Number of parser threads, or @c 0 to use one per
+ *                    online processor but one (at least one)
+ *
+ * @return Pointer to the pipelined parser, or @c NULL otherwise
+ *
+ * @note Follows the same grammar as @a csv_parser_init().
+ */
+csv_pipeline_td *csv_pipeline_init(const char *filename, const char *delim,
+        bool has_header, size_t num_parsers);
+
+/**
+ * @brief Stop the threads and deallocate the pipelined CSV parser
+ *
+ * @param csv_pipeline Pipelined CSV parser to free
+ */
+void csv_pipeline_destroy(csv_pipeline_td *csv_pipeline);
+
+/**
+ * @brief Get the header of the CSV file, if any
+ *
+ * @param csv_pipeline Pipelined CSV parser to get its header from
+ *
+ * @return Header of the CSV file, or @c NULL otherwise
+ *
+ * @note Waits for the first block to be parsed.
+ */
+const csv_row_td *csv_pipeline_header(csv_pipeline_td *csv_pipeline);
+
+/**
+ * @brief Get the next row without copying its fields
+ *
+ * @param csv_pipeline Pipelined CSV parser where to get the row from
+ *
+ * @return Pointer to the next row view, in file order, or @c NULL on
+ *         EOF or error
+ *
+ * @note The fields are valid until the next call.
+ */
+const csv_row_view_td *csv_pipeline_row_view(csv_pipeline_td *csv_pipeline);
+
+/**
+ * @brief Get the next row
+ *
+ * @param csv_pipeline Pipelined CSV parser where to get the row from
+ *
+ * @return Pointer to the next row, in file order, or @c NULL on EOF or
+ *         error
+ *
+ * @note The row must be freed with @a csv_parser_destroy_row().
+ */
+csv_row_td *csv_pipeline_row(csv_pipeline_td *csv_pipeline);
+
+/**
+ * @brief Tell whether the pipeline stopped because of an error
+ *
+ * @param csv_pipeline Pipelined CSV parser to check
+ *
+ * @return @c true if a read or allocation error happened
+ */
+bool csv_pipeline_failed(csv_pipeline_td *csv_pipeline);
+
+
+#endif /* ! CSV_PIPELINE_H */
@@ -0,0 +1,208 @@
+/**
+ * @file csvpool.h
+ *
+ * @brief Work-stealing thread pool to parse many CSV files declaration
+ *
+ * Every worker has its own deque of tasks: it takes the newest task of
+ * its own deque and, when that's empty, steals the oldest task of
+ * another worker.  A file is a single task when it's small; a large
+ * file is indexed by the worker that picks it up and turned into
+ * chunk tasks that idle workers steal, so one big file doesn't keep
+ * a single core busy while the others wait.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_POOL_H
+#define CSV_POOL_H
+
+/* System includes */
+#include <pthread.h>    /* pthread_t, pthread_mutex_t, pthread_cond_t */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+
+/* Local includes */
+#include <csvparallel.h>
+#include <csvparser.h>
+
+
+/* Files at least this large are split into chunk tasks */
+#ifndef CSV_POOL_SPLIT
+#define CSV_POOL_SPLIT (8 * 1024 * 1024)
+#endif
+
+/* Approximate size of the records of a chunk task */
+#ifndef CSV_POOL_CHUNK
+#define CSV_POOL_CHUNK (1024 * 1024)
+#endif
+
+
+/**
+ * @typedef csv_pool_row_fn_td
+ *
+ * @brief Function called for every row of a job
+ *
+ * @param row Row, valid only during the call
+ * @param arg Argument given with the job
+ */
+typedef void (*csv_pool_row_fn_td)(const csv_row_view_td *row, void *arg);
+
+
+/**
+ * @typedef csv_pool_job_td
+ *
+ * @brief Structure for a file submitted to the pool
+ */
+typedef struct {
+    csv_parser_td *csv_parser;  /**< Parser of the file */
+    csv_pool_row_fn_td fn;      /**< Function called for every row */
+    void *arg;                  /**< Argument for @e fn */
+    int fd;                     /**< File descriptor, if split */
+    const char *data;           /**< Contents of the file, if split */
+    size_t size;                /**< Size of the file, if split */
+    csv_record_index_td index;  /**< Records of the file, if split */
+    size_t pending;             /**< Chunk tasks not finished yet */
+} csv_pool_job_td;
+
+
+/**
+ * @typedef csv_task_td
+ *
+ * @brief Structure for a task: a whole file, or a range of its records
+ */
+typedef struct {
+    csv_pool_job_td *job;       /**< File of the task */
+    bool chunk;                 /**< Whether it's a range of records */
+    size_t first;               /**< First record of the range */
+    size_t last;                /**< Record past the end of the range */
+} csv_task_td;
+
+
+/**
+ * @typedef csv_deque_td
+ *
+ * @brief Structure for the deque of tasks of a worker
+ */
+typedef struct {
+    csv_task_td **tasks;        /**< Circular buffer of tasks */
+    size_t head;                /**< Oldest task (stolen by others) */
+    size_t len;                 /**< Number of tasks */
+    size_t cap;                 /**< Capacity of @e tasks */
+    pthread_mutex_t lock;       /**< Protects the deque */
+} csv_deque_td;
+
+
+/**
+ * @typedef csv_pool_td
+ *
+ * @brief Structure for the work-stealing thread pool
+ */
+typedef struct csv_pool_s csv_pool_td;
+
+
+/**
+ * @typedef csv_worker_td
+ *
+ * @brief Structure for a worker of the pool
+ */
+typedef struct {
+    csv_pool_td *pool;          /**< Pool of the worker */
+    size_t id;                  /**< Index of the worker */
+    pthread_t thread;           /**< Thread of the worker */
+    csv_deque_td deque;         /**< Tasks of the worker */
+    char *buf;                  /**< Scratch record for chunk tasks */
+    size_t buf_cap;             /**< Capacity of @e buf */
+    csv_row_view_td view;       /**< Scratch view for chunk tasks */
+    size_t view_cap;            /**< Capacity of @e view */
+} csv_worker_td;
+
+
+/**
+ * @struct csv_pool_s
+ *
+ * @brief Structure for the work-stealing thread pool
+ */
+struct csv_pool_s {
+    csv_worker_td *workers;     /**< Workers */
+    size_t num_workers;         /**< Number of running workers */
+    size_t next_worker;         /**< Deque for the next submitted file */
+    pthread_mutex_t lock;       /**< Protects everything below */
+    pthread_cond_t work_cond;   /**< Signalled when tasks are queued */
+    pthread_cond_t done_cond;   /**< Signalled when all tasks finish */
+    size_t queued;              /**< Tasks waiting in the deques */
+    size_t active;              /**< Tasks queued or running */
+    bool failed;                /**< A task failed since the last wait */
+    bool stop;                  /**< Workers have to finish */
+};
+
+
+/* Public interface */
+/**
+ * @brief Initialize the pool and start its workers
+ *
+ * @param num_threads Number of workers, or @c 0 to use one per online
+ *                    processor
+ *
+ * @return Pointer to the pool, or @c NULL otherwise
+ */
+csv_pool_td *csv_pool_init(size_t num_threads);
+
+/**
+ * @brief Wait for the submitted files, stop the workers and deallocate
+ *        the pool
+ *
+ * @param pool Pool to free
+ */
+void csv_pool_destroy(csv_pool_td *pool);
+
+/**
+ * @brief Submit a file to be parsed by the pool
+ *
+ * @param pool       Pool where to submit the file
+ * @param csv_parser Parser of the file; parsing starts wherever it is
+ *                   (after the header, if it has one)
+ * @param fn         Function called for every row
+ * @param arg        Argument for @p fn
+ *
+ * @return @c true on success, @c false otherwise
+ *
+ * @note Rows of a split file are delivered concurrently, in order
+ *       within every chunk, so @p fn must be thread-safe.
+ * @note The parser can't be used until @a csv_pool_wait() returns.
+ */
+bool csv_pool_submit(csv_pool_td *pool, csv_parser_td *csv_parser,
+        csv_pool_row_fn_td fn, void *arg);
+
+/**
+ * @brief Wait until every submitted file is parsed
+ *
+ * @param pool Pool to wait for
+ *
+ * @return @c true if every file since the last wait was parsed, or
+ *         @c false if any task failed
+ */
+bool csv_pool_wait(csv_pool_td *pool);
+
+
+#endif /* ! CSV_POOL_H */
@@ -0,0 +1,344 @@
+/**
+ * @file csvschema.h
+ *
+ * @brief Schema-driven typed parsing of CSV fields declaration
+ *
+ * A schema assigns a type to every column.  Typed batches convert the
+ * bytes of every field straight into typed column buffers, without
+ * creating intermediate C strings.  Number parsing does not depend on
+ * the current locale: the decimal separator is always '.'.
+ *
+ * Empty fields are stored as nulls.  Fields that cannot be converted
+ * are also stored as nulls, and a conversion error is recorded with
+ * the line and column where it happened.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_SCHEMA_H
+#define CSV_SCHEMA_H
+
+/* System includes */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+#include <stdint.h>     /* int32_t, int64_t, uint64_t */
+
+/* Local includes */
+#include <csvbatch.h>
+#include <csvdict.h>
+#include <csvparser.h>
+
+
+/**
+ * @typedef csv_type_td
+ *
+ * @brief Type of the values of a column
+ */
+typedef enum {
+    CSV_TYPE_STRING,    /**< Raw bytes, as in @e csv_batch_td */
+    CSV_TYPE_INT64,     /**< Signed 64-bit integer */
+    CSV_TYPE_UINT64,    /**< Unsigned 64-bit integer */
+    CSV_TYPE_DOUBLE,    /**< Double precision floating point number */
+    CSV_TYPE_BOOL,      /**< Boolean (true/false, t/f, yes/no, 1/0) */
+    CSV_TYPE_DATE,      /**< Date as @c YYYY-MM-DD, in days since epoch */
+    CSV_TYPE_DICT       /**< String, as a code of a shared dictionary */
+} csv_type_td;
+
+
+/**
+ * @typedef csv_schema_td
+ *
+ * @brief Structure for the types of the columns of a CSV file
+ */
+typedef struct {
+    csv_type_td *types;     /**< Type of every column */
+    bool *nullable;         /**< Whether every column may hold nulls */
+    size_t *max_width;      /**< Widest value of every column, in bytes */
+    csv_dict_td **dicts;    /**< Shared dictionary of every column */
+    size_t num_columns;     /**< Number of columns */
+} csv_schema_td;
+
+
+/**
+ * @typedef csv_typed_column_td
+ *
+ * @brief Structure for a column of a typed batch
+ */
+typedef struct {
+    csv_type_td type;       /**< Type of the values */
+    union {
+        int64_t *i64;       /**< Values of @c CSV_TYPE_INT64 columns */
+        uint64_t *u64;      /**< Values of @c CSV_TYPE_UINT64 columns */
+        double *f64;        /**< Values of @c CSV_TYPE_DOUBLE columns */
+        bool *boolean;      /**< Values of @c CSV_TYPE_BOOL columns */
+        int32_t *date;      /**< Values of @c CSV_TYPE_DATE columns */
+        uint32_t *code;     /**< Values of @c CSV_TYPE_DICT columns */
+    } values;               /**< Fixed-width values, one per row */
+    csv_column_td strings;  /**< Values of @c CSV_TYPE_STRING columns */
+    csv_dict_td *dict;      /**< Dictionary of @c CSV_TYPE_DICT columns */
+    bool owns_dict;         /**< Whether @e dict is freed with the batch */
+    bool *valid;            /**< Whether each row holds a value */
+} csv_typed_column_td;
+
+
+/**
+ * @typedef csv_conv_error_td
+ *
+ * @brief Structure for a field that could not be converted
+ */
+typedef struct {
+    size_t line_no;     /**< Line number of the record */
+    size_t row;         /**< Row index within the batch */
+    size_t column;      /**< Column index */
+} csv_conv_error_td;
+
+
+/**
+ * @typedef csv_typed_batch_td
+ *
+ * @brief Structure for a batch of rows converted to typed columns
+ */
+typedef struct {
+    csv_typed_column_td *columns;   /**< Columns of the batch */
+    size_t num_columns;             /**< Number of columns */
+    size_t num_rows;                /**< Number of rows stored */
+    size_t max_rows;                /**< Maximum number of rows */
+    csv_conv_error_td *errors;      /**< Conversion errors */
+    size_t num_errors;              /**< Number of conversion errors */
+    size_t errors_cap;              /**< Capacity of @e errors */
+} csv_typed_batch_td;
+
+
+/* Public interface */
+/**
+ * @brief Initialize a schema where every column is a string
+ *
+ * @param num_columns Number of columns
+ *
+ * @return Pointer to the new schema, or @c NULL otherwise
+ *
+ * @note Every column is nullable and its maximum width is unknown (0).
+ */
+csv_schema_td *csv_schema_init(size_t num_columns);
+
+/**
+ * @brief Deallocate the memory used by a schema
+ *
+ * @param csv_schema Schema to free
+ */
+void csv_schema_destroy(csv_schema_td *csv_schema);
+
+/**
+ * @brief Set the type of a column
+ *
+ * @param csv_schema Schema to modify
+ * @param column     Column index
+ * @param type       Type of the column
+ *
+ * @return @c true on success, @c false if @p column is out of bounds
+ */
+bool csv_schema_set_type(csv_schema_td *csv_schema, size_t column,
+        csv_type_td type);
+
+/**
+ * @brief Dictionary-encode a column, using a shared dictionary
+ *
+ * The type of the column is set to @c CSV_TYPE_DICT.  Typed batches
+ * built from the schema intern the values of the column in
+ * @p csv_dict and store their codes, so codes are consistent across
+ * every batch (and every file) that shares @p csv_dict.
+ *
+ * @param csv_schema Schema to modify
+ * @param column     Column index
+ * @param csv_dict   Dictionary to share, owned by the caller, who must
+ *                   keep it alive while batches use it; if @c NULL, each
+ *                   typed batch creates and owns its own dictionary
+ *
+ * @return @c true on success, @c false if @p column is out of bounds
+ */
+bool csv_schema_set_dict(csv_schema_td *csv_schema, size_t column,
+        csv_dict_td *csv_dict);
+
+/**
+ * @brief Infer the schema of a CSV file from its first bytes
+ *
+ * Reads rows from the start of the file until @p sample_bytes bytes
+ * have been consumed, and infers the type, nullability and maximum
+ * width of every column from them.  The number of columns is taken
+ * from the header, if any, or from the first sampled row otherwise.
+ *
+ * @param csv_parser   CSV parser of the file; only its header is read,
+ *                     the position of the next row is not modified
+ * @param sample_bytes Maximum number of bytes to sample
+ *
+ * @return Pointer to the inferred schema, or @c NULL otherwise
+ *
+ * @note Integers are preferred to doubles, and columns in which no
+ *       value could be sampled are strings.
+ */
+csv_schema_td *csv_infer_schema(csv_parser_td *csv_parser,
+        size_t sample_bytes);
+
+/**
+ * @brief Infer the schema of a CSV file from its first bytes and from
+ *        stripes spread over the rest of the file
+ *
+ * Like @a csv_infer_schema(), but the @p sample_bytes budget is split
+ * evenly between the start of the file and @p num_stripes stripes at
+ * evenly spaced offsets, so that a column whose values change late in
+ * the file is not missed, while the cost stays bounded regardless of
+ * the size of the file.
+ *
+ * @param csv_parser   CSV parser of the file
+ * @param sample_bytes Maximum number of bytes to sample, in total
+ * @param num_stripes  Number of stripes besides the start of the file
+ *
+ * @return Pointer to the inferred schema, or @c NULL otherwise
+ *
+ * @note A stripe starts at the record following its offset; rows whose
+ *       number of fields differs from the number of columns are
+ *       ignored, as the offset might have fallen inside a quoted field.
+ */
+csv_schema_td *csv_infer_schema_stripes(csv_parser_td *csv_parser,
+        size_t sample_bytes, size_t num_stripes);
+
+/**
+ * @brief Initialize an empty typed batch following a schema
+ *
+ * @param csv_schema Schema of the batch
+ * @param max_rows   Maximum number of rows the batch can hold
+ *
+ * @return Pointer to the new typed batch, or @c NULL otherwise
+ *
+ * @note The batch copies the types; @p csv_schema may be freed.
+ */
+csv_typed_batch_td *csv_typed_batch_init(const csv_schema_td *csv_schema,
+        size_t max_rows);
+
+/**
+ * @brief Deallocate the memory used by a typed batch
+ *
+ * @param csv_batch Typed batch to free
+ */
+void csv_typed_batch_destroy(csv_typed_batch_td *csv_batch);
+
+/**
+ * @brief Remove all rows and errors from a typed batch
+ *
+ * @param csv_batch Typed batch to clear
+ *
+ * @note Dictionaries are kept, so codes stay valid across fills.
+ */
+void csv_typed_batch_clear(csv_typed_batch_td *csv_batch);
+
+/**
+ * @brief Convert a row and append it to a typed batch
+ *
+ * @param csv_batch Typed batch where to append the row
+ * @param view      Row to convert
+ * @param line_no   Line number of the row, used to report errors
+ *
+ * @return @c true on success (even if some fields were not
+ *         convertible), @c false if the batch is full or on allocation
+ *         failure
+ */
+bool csv_typed_batch_append(csv_typed_batch_td *csv_batch,
+        const csv_row_view_td *view, size_t line_no);
+
+/**
+ * @brief Fill a typed batch with the next rows of the CSV file
+ *
+ * @param csv_parser CSV parser where to read the rows from
+ * @param csv_batch  Typed batch to fill (it is cleared first)
+ *
+ * @return Number of rows stored in the batch, @c 0 on EOF or error
+ *
+ * @note On error, the batch is left empty, and the parser is moved back
+ *       to where it was, so the rows read are read again by the next
+ *       call.
+ */
+size_t csv_parser_typed_batch(csv_parser_td *csv_parser,
+        csv_typed_batch_td *csv_batch);
+
+/**
+ * @brief Parse a signed 64-bit integer
+ *
+ * @param s   Bytes to parse (surrounding spaces are ignored)
+ * @param len Number of bytes of @p s
+ * @param out Where to store the value
+ *
+ * @return @c true on success, @c false if not a valid integer or out of
+ *         range
+ */
+bool csv_parse_int64(const char *s, size_t len, int64_t *out);
+
+/**
+ * @brief Parse an unsigned 64-bit integer
+ *
+ * @param s   Bytes to parse (surrounding spaces are ignored)
+ * @param len Number of bytes of @p s
+ * @param out Where to store the value
+ *
+ * @return @c true on success, @c false if not a valid integer or out of
+ *         range
+ */
+bool csv_parse_uint64(const char *s, size_t len, uint64_t *out);
+
+/**
+ * @brief Parse a double precision floating point number
+ *
+ * @param s   Bytes to parse (surrounding spaces are ignored)
+ * @param len Number of bytes of @p s
+ * @param out Where to store the value, correctly rounded
+ *
+ * @return @c true on success, @c false if not a valid number
+ *
+ * @note Accepts @c inf, @c infinity and @c nan, in any case.
+ */
+bool csv_parse_double(const char *s, size_t len, double *out);
+
+/**
+ * @brief Parse a boolean
+ *
+ * @param s   Bytes to parse (surrounding spaces are ignored)
+ * @param len Number of bytes of @p s
+ * @param out Where to store the value
+ *
+ * @return @c true on success, @c false if not a valid boolean
+ */
+bool csv_parse_bool(const char *s, size_t len, bool *out);
+
+/**
+ * @brief Parse a date in the @c YYYY-MM-DD format
+ *
+ * @param s   Bytes to parse (surrounding spaces are ignored)
+ * @param len Number of bytes of @p s
+ * @param out Where to store the number of days since 1970-01-01
+ *
+ * @return @c true on success, @c false if not a valid date
+ */
+bool csv_parse_date(const char *s, size_t len, int32_t *out);
+
+
+#endif /* ! CSV_SCHEMA_H */
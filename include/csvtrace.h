@@ -0,0 +1,73 @@
+/**
+ * @file csvtrace.h
+ *
+ * @brief Static tracepoints (USDT) of the parser declaration
+ *
+ * With @c CSV_USDT defined (the Makefile does it when @c <sys/sdt.h> is
+ * available), every probe is a single @c nop plus a note in the ELF
+ * file, so that tools such as bpftrace or perf can attach to it in
+ * a running process; otherwise, probes aren't compiled at all.
+ *
+ * Probes of the @c csvparser provider:
+ *   - @c open(filename, ok): the CSV file was opened, or not
+ *   - @c header__start(), @c header__done(num_fields): header parsed
+ *   - @c record__start(): a record is about to be read
+ *   - @c record__done(offset, len, num_fields): a record was split
+ *   - @c refill__start(offset), @c refill__done(bytes): read buffer
+ *     refilled from the file at @c offset
+ *   - @c buffer__grow(old_cap, new_cap): read buffer grown
+ *
+ * For instance, `bpftrace -e 'usdt:./bin/main:csvparser:refill__done
+ * { @bytes = hist(arg0); }'`.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_TRACE_H
+#define CSV_TRACE_H
+
+#if defined(CSV_USDT)
+
+/* System includes */
+#include <sys/sdt.h>    /* DTRACE_PROBE* */
+
+#define CSV_TRACE0(name) DTRACE_PROBE(csvparser, name)
+#define CSV_TRACE1(name, a) DTRACE_PROBE1(csvparser, name, a)
+#define CSV_TRACE2(name, a, b) DTRACE_PROBE2(csvparser, name, a, b)
+#define CSV_TRACE3(name, a, b, c) DTRACE_PROBE3(csvparser, name, a, b, c)
+
+#else
+
+/* Arguments are still type-checked, but never evaluated */
+#define CSV_TRACE0(name) do { } while (0)
+#define CSV_TRACE1(name, a) do { if (0) { (void) (a); } } while (0)
+#define CSV_TRACE2(name, a, b) \
+    do { if (0) { (void) (a); (void) (b); } } while (0)
+#define CSV_TRACE3(name, a, b, c) \
+    do { if (0) { (void) (a); (void) (b); (void) (c); } } while (0)
+
+#endif /* CSV_USDT */
+
+
+#endif /* ! CSV_TRACE_H */
@@ -0,0 +1,70 @@
+/**
+ * @file csvutil.h
+ *
+ * @brief Helpers shared by the modules of the library declaration
+ *
+ * Not part of the public interface: hashing of byte ranges (for the
+ * dictionaries, the refresh check and the parse cache) and growth of
+ * the arrays that hold records, fields and values.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_UTIL_H
+#define CSV_UTIL_H
+
+/* System includes */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+#include <stdint.h>     /* uint64_t */
+
+
+/* Public interface */
+/**
+ * @brief Hash bytes, eight at a time
+ *
+ * @param data Bytes to hash
+ * @param len  Number of bytes to hash
+ *
+ * @return Hash of the bytes
+ *
+ * @note The hash is stored in parse caches; changing it makes every
+ *       cache stale.
+ */
+uint64_t csv_hash_bytes(const char *data, size_t len);
+
+/**
+ * @brief Grow an array, if needed, so that it holds a number of items
+ *
+ * @param array Pointer to the array to grow
+ * @param cap   Pointer to the capacity of the array, in items
+ * @param need  Number of items the array must hold
+ * @param size  Size of an item
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+bool csv_reserve(void *array, size_t *cap, size_t need, size_t size);
+
+
+#endif /* ! CSV_UTIL_H */
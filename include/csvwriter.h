@@ -0,0 +1,214 @@
+/**
+ * @file csvwriter.h
+ *
+ * @brief Buffered CSV writer declaration
+ *
+ * Rows are written so that @a csv_parser_row() reads them back as they
+ * were: a field is quoted only when it contains the delimiter, a quote
+ * or a line break (or when it would otherwise be read as a comment or
+ * a blank line), and quotes are doubled only inside quoted fields.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+/* System includes */
+#include <stdbool.h>    /* bool */
+#include <stddef.h>     /* size_t */
+#include <stdio.h>      /* FILE */
+#include <sys/types.h>  /* off_t */
+
+/* Local includes */
+#include <csvparser.h>
+
+
+/**
+ * @typedef csv_writer_td
+ *
+ * @brief Structure for the CSV writer
+ */
+typedef struct {
+    FILE *fp;           /**< File handler */
+    bool own_fp;        /**< Whether to close @e fp when destroyed */
+    char delim;         /**< Delimiter between fields */
+    char *buf;          /**< Output buffer */
+    size_t buf_len;     /**< Number of bytes in the output buffer */
+    size_t buf_cap;     /**< Capacity of the output buffer */
+    size_t num_fields;  /**< Fields written in the current record */
+    bool first_empty;   /**< Whether its first field was empty, and
+                             written unquoted */
+    bool failed;        /**< Whether a write failed */
+    int run_fd;         /**< File of the run of records to copy, or -1
+                             if there's none pending */
+    off_t run_start;    /**< File offset where the run starts */
+    off_t run_end;      /**< File offset right after the run */
+    bool try_copy_range;    /**< Whether to copy with copy_file_range() */
+    bool try_splice;    /**< Whether to copy with splice() */
+} csv_writer_td;
+
+
+/* Public interface */
+/**
+ * @brief Initialize a CSV writer that creates (or truncates) a file
+ *
+ * @param filename Path to the CSV file to write
+ * @param delim    Delimiter between fields, as for @a csv_parser_init()
+ *
+ * @return Pointer to the CSV writer, or @c NULL otherwise
+ */
+csv_writer_td *csv_writer_init(const char *filename, const char *delim);
+
+/**
+ * @brief Initialize a CSV writer over an open stream
+ *
+ * @param fp    Stream where to write (not closed by the writer)
+ * @param delim Delimiter between fields, as for @a csv_parser_init()
+ *
+ * @return Pointer to the CSV writer, or @c NULL otherwise
+ */
+csv_writer_td *csv_writer_init_fp(FILE *fp, const char *delim);
+
+/**
+ * @brief Flush and deallocate the CSV writer
+ *
+ * @param csv_writer CSV writer to free
+ *
+ * @note Use @a csv_writer_flush() first to know whether every byte was
+ *       written.
+ */
+void csv_writer_destroy(csv_writer_td *csv_writer);
+
+/**
+ * @brief Write a field at the end of the current record
+ *
+ * @param csv_writer CSV writer where to write
+ * @param data       Bytes of the field
+ * @param len        Number of bytes of the field
+ *
+ * @return @c true on success, @c false on error
+ */
+bool csv_writer_field(csv_writer_td *csv_writer, const char *data,
+        size_t len);
+
+/**
+ * @brief Write a field as read, at the end of the current record
+ *
+ * The bytes are copied as they are, without quoting them, so they have
+ * to be a field as the parser read it from a file with the same
+ * delimiter (see @a csv_parser_raw_field()).
+ *
+ * @param csv_writer CSV writer where to write
+ * @param data       Bytes of the field, quotes included
+ * @param len        Number of bytes of the field
+ *
+ * @return @c true on success, @c false on error
+ */
+bool csv_writer_raw_field(csv_writer_td *csv_writer, const char *data,
+        size_t len);
+
+/**
+ * @brief Write a record as read
+ *
+ * The bytes are copied as they are, and followed by a newline, so they
+ * have to be a record as the parser read it from a file with the same
+ * delimiter (see @a csv_parser_raw_record()).
+ *
+ * @param csv_writer CSV writer where to write
+ * @param data       Bytes of the record, without its newline
+ * @param len        Number of bytes of the record
+ *
+ * @return @c true on success, @c false on error (or if a record was
+ *         already started)
+ */
+bool csv_writer_raw_record(csv_writer_td *csv_writer, const char *data,
+        size_t len);
+
+/**
+ * @brief Copy the current record of a parser, as it is in its file
+ *
+ * Consecutive records copied from the same file make a single run,
+ * which is copied within the kernel (@c copy_file_range() or
+ * @c splice(), on Linux) when any other byte is written, or on flush;
+ * so a filter only locates the records, and bytes it keeps don't pass
+ * through user space.
+ *
+ * @param csv_writer CSV writer where to write
+ * @param csv_parser CSV parser whose current record to copy
+ *
+ * @return @c true on success, @c false on error (or if a record was
+ *         already started, or the parser has no current record)
+ *
+ * @note The parser has to stay open until the writer is flushed.
+ * @note Line terminators (CRLF included) are copied as they are.
+ */
+bool csv_writer_copy_record(csv_writer_td *csv_writer,
+        const csv_parser_td *csv_parser);
+
+/**
+ * @brief End the current record
+ *
+ * @param csv_writer CSV writer where to write
+ *
+ * @return @c true on success, @c false on error
+ *
+ * @note A record without fields is written as an empty line, which
+ *       parsers skip.
+ */
+bool csv_writer_end_record(csv_writer_td *csv_writer);
+
+/**
+ * @brief Write a whole row as a record
+ *
+ * @param csv_writer CSV writer where to write
+ * @param row        Row to write
+ *
+ * @return @c true on success, @c false on error
+ */
+bool csv_writer_row(csv_writer_td *csv_writer, const csv_row_td *row);
+
+/**
+ * @brief Write a whole row view as a record
+ *
+ * @param csv_writer CSV writer where to write
+ * @param view       Row view to write
+ *
+ * @return @c true on success, @c false on error
+ */
+bool csv_writer_row_view(csv_writer_td *csv_writer,
+        const csv_row_view_td *view);
+
+/**
+ * @brief Write the buffered bytes to the stream, and flush it
+ *
+ * @param csv_writer CSV writer to flush
+ *
+ * @return @c true if every byte written so far made it to the stream,
+ *         @c false otherwise
+ */
+bool csv_writer_flush(csv_writer_td *csv_writer);
+
+
+#endif /* ! CSV_WRITER_H */
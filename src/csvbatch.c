@@ -0,0 +1,213 @@
+/**
+ * @file csvbatch.c
+ *
+ * @brief Columnar batches of CSV rows implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* System includes */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdlib.h>     /* malloc, realloc, free, NULL */
+#include <string.h>     /* memcpy */
+
+/* Local includes */
+#include <csvbatch.h>
+#include <csvparser.h>
+
+
+/* Initialize an empty batch */
+csv_batch_td *csv_batch_init(size_t num_columns, size_t max_rows)
+{
+    if (num_columns == 0 || max_rows == 0) {
+        return NULL;
+    }
+
+    csv_batch_td *csv_batch = malloc(sizeof(csv_batch_td));
+    if (csv_batch == NULL) {
+        return NULL;
+    }
+
+    csv_batch->num_rows = 0;
+    csv_batch->max_rows = max_rows;
+    csv_batch->num_columns = 0;
+    csv_batch->columns = malloc(sizeof(csv_column_td) * num_columns);
+    if (csv_batch->columns == NULL) {
+        free(csv_batch);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < num_columns; ++i) {
+        csv_column_td *column = &csv_batch->columns[i];
+        column->values = NULL;
+        column->values_len = 0;
+        column->values_cap = 0;
+        column->offsets = malloc(sizeof(size_t) * (max_rows + 1));
+        if (column->offsets == NULL) {
+            csv_batch_destroy(csv_batch);
+            return NULL;
+        }
+        column->offsets[0] = 0;
+        csv_batch->num_columns++;
+    }
+
+    return csv_batch;
+}
+
+
+/* Deallocate the memory used by a batch */
+void csv_batch_destroy(csv_batch_td *csv_batch)
+{
+    if (csv_batch == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < csv_batch->num_columns; ++i) {
+        free(csv_batch->columns[i].values);
+        free(csv_batch->columns[i].offsets);
+    }
+
+    free(csv_batch->columns);
+    free(csv_batch);
+}
+
+
+/* Remove all rows from a batch, keeping its buffers for reuse */
+void csv_batch_clear(csv_batch_td *csv_batch)
+{
+    if (csv_batch == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < csv_batch->num_columns; ++i) {
+        csv_batch->columns[i].values_len = 0;
+    }
+
+    csv_batch->num_rows = 0;
+}
+
+
+/* Append a row to a batch */
+bool csv_batch_append(csv_batch_td *csv_batch, const csv_row_view_td *view)
+{
+    if (csv_batch == NULL || view == NULL ||
+            csv_batch->num_rows == csv_batch->max_rows) {
+        return false;
+    }
+
+    size_t row = csv_batch->num_rows;
+    for (size_t i = 0; i < csv_batch->num_columns; ++i) {
+        csv_column_td *column = &csv_batch->columns[i];
+        const char *data = NULL;
+        size_t len = 0;
+        if (i < view->num_fields) {
+            data = view->fields[i].data;
+            len = view->fields[i].len;
+        }
+        if (!csv_column_append(column, row, data, len)) {
+            /* Roll back the columns already written */
+            for (size_t j = 0; j < i; ++j) {
+                csv_batch->columns[j].values_len =
+                    csv_batch->columns[j].offsets[row];
+            }
+            return false;
+        }
+    }
+
+    csv_batch->num_rows++;
+
+    return true;
+}
+
+
+/* Append a value to a column */
+bool csv_column_append(csv_column_td *column, size_t row, const char *data,
+        size_t len)
+{
+    if (column->values_len + len > column->values_cap) {
+        size_t cap = (column->values_cap) ? column->values_cap : 64;
+        while (cap < column->values_len + len) {
+            cap *= 2;
+        }
+        char *values = realloc(column->values, cap);
+        if (values == NULL) {
+            return false;
+        }
+        column->values = values;
+        column->values_cap = cap;
+    }
+
+    if (len > 0) {
+        memcpy(column->values + column->values_len, data, len);
+        column->values_len += len;
+    }
+    column->offsets[row + 1] = column->values_len;
+
+    return true;
+}
+
+
+/* Fill a batch with the next rows of the CSV file */
+size_t csv_parser_batch(csv_parser_td *csv_parser, csv_batch_td *csv_batch)
+{
+    const csv_row_view_td *view;
+
+    if (csv_parser == NULL || csv_batch == NULL) {
+        return 0;
+    }
+
+    csv_checkpoint_td start = csv_parser_checkpoint(csv_parser);
+    csv_batch_clear(csv_batch);
+    while (csv_batch->num_rows < csv_batch->max_rows &&
+            (view = csv_parser_row_view(csv_parser)) != NULL) {
+        if (!csv_batch_append(csv_batch, view)) {
+            /* Give the rows read back to the parser, so none is lost */
+            csv_batch_clear(csv_batch);
+            (void) csv_parser_resume(csv_parser, start.offset,
+                    start.line_no, NULL);
+            return 0;
+        }
+    }
+
+    return csv_batch->num_rows;
+}
+
+
+/* Get a value of a batch */
+const char *csv_batch_value(const csv_batch_td *csv_batch, size_t column,
+        size_t row, size_t *len)
+{
+    if (csv_batch == NULL || column >= csv_batch->num_columns ||
+            row >= csv_batch->num_rows) {
+        return NULL;
+    }
+
+    const csv_column_td *col = &csv_batch->columns[column];
+    if (len != NULL) {
+        *len = col->offsets[row + 1] - col->offsets[row];
+    }
+
+    /* An empty column has no buffer yet; any non-NULL pointer will do */
+    return (col->values != NULL) ? col->values + col->offsets[row] : "";
+}
@@ -0,0 +1,463 @@
+/**
+ * @file csvcache.c
+ *
+ * @brief Persistent parse cache implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <fcntl.h>      /* open, O_RDONLY */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* uint64_t, int64_t */
+#include <stdio.h>      /* FILE, fopen, fwrite, rename, remove, snprintf */
+#include <stdlib.h>     /* malloc, free, NULL */
+#include <string.h>     /* memcpy, memcmp, strlen */
+#include <sys/mman.h>   /* mmap, munmap, posix_madvise */
+#include <sys/stat.h>   /* stat, fstat, S_ISREG */
+#include <unistd.h>     /* close, pread */
+
+/* Local includes */
+#include <csvcache.h>
+#include <csvparser.h>
+#include <csvutil.h>
+
+
+/* First bytes of a cache file; also tells the byte order apart */
+#define CSV_CACHE_MAGIC "CSVCAC01"
+
+/* Number of 64-bit words of the header of a cache file */
+#define CSV_CACHE_HEAD 10
+
+
+/**
+ * @typedef csv_cache_builder_td
+ *
+ * @brief Structure for a parse cache being built in memory
+ */
+typedef struct {
+    csv_cache_record_td *records;   /**< Every record */
+    size_t num_records;             /**< Number of records */
+    size_t records_cap;             /**< Capacity of @e records */
+    uint64_t *fields;               /**< Offset of every field */
+    size_t num_fields;              /**< Number of fields */
+    size_t fields_cap;              /**< Capacity of @e fields */
+    char *values;                   /**< Unescaped fields */
+    size_t values_len;              /**< Number of bytes of @e values */
+    size_t values_cap;              /**< Capacity of @e values */
+    uint64_t lines;                 /**< Lines in the file */
+} csv_cache_builder_td;
+
+
+/**
+ * @brief Get the path of the cache of a CSV file
+ *
+ * Next to the file, it's the path with a suffix; in a cache directory,
+ * it's named after the hash of the path, so that files with the same
+ * name in different directories don't share it.
+ *
+ * @param path   Path to the CSV file
+ * @param dir    Cache directory, or @c NULL
+ * @param suffix Suffix to append to the name of the cache
+ *
+ * @return Newly allocated path, or @c NULL on allocation failure
+ */
+static char *s_cache_path(const char *path, const char *dir,
+        const char *suffix)
+{
+    size_t len = (dir) ? strlen(dir) + 1 + 16 : strlen(path);
+    size_t suffix_len = strlen(suffix);
+    char *cache_path = malloc(len + suffix_len + 1);
+
+    if (cache_path == NULL) {
+        return NULL;
+    }
+    if (dir != NULL) {
+        snprintf(cache_path, len + 1, "%s/%016llx", dir,
+                (unsigned long long) csv_hash_bytes(path, strlen(path)));
+    } else {
+        memcpy(cache_path, path, len);
+    }
+    memcpy(cache_path + len, suffix, suffix_len + 1);
+
+    return cache_path;
+}
+
+
+/**
+ * @brief Scan and split every record of a buffer into a cache
+ *
+ * Records are split as a parser does: a trailing carriage return is
+ * dropped, and the fields are unescaped.
+ *
+ * @param builder Cache where to store the records
+ * @param data    Contents of the CSV file
+ * @param size    Size of @p data
+ * @param delim   Delimiter between fields
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_cache_scan(csv_cache_builder_td *builder, const char *data,
+        size_t size, char delim)
+{
+    csv_scan_td scan;
+    csv_span_td span;
+    csv_row_view_td view = { NULL, 0 };
+    size_t view_cap = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    bool ok = true;
+
+    csv_scan_init(&scan, delim, CSV_SCAN_LINE_START, 0);
+    while (csv_scan(&scan, data, size, &span, 1) == 1 ||
+            csv_scan_flush(&scan, &span)) {
+        size_t len = span.end - span.start;
+        if (len > 0 && data[span.end - 1] == '\r') {
+            len--;
+        }
+        ok = csv_reserve(&line, &line_cap, len + 1, 1) &&
+            csv_reserve(&builder->records, &builder->records_cap,
+                    builder->num_records + 1, sizeof(csv_cache_record_td));
+        if (!ok) {
+            break;
+        }
+        memcpy(line, data + span.start, len);
+        line[len] = '\0';
+
+        csv_cache_record_td *record = &builder->records[builder->num_records];
+        record->offset = span.start;
+        record->end = scan.pos;
+        record->lines = scan.lines;
+        record->field = builder->num_fields;
+        builder->num_records++;
+
+        ok = csv_split_record(line, delim, &view, &view_cap) &&
+            csv_reserve(&builder->fields, &builder->fields_cap,
+                    builder->num_fields + view.num_fields, sizeof(uint64_t));
+        for (size_t i = 0; ok && i < view.num_fields; ++i) {
+            const csv_field_td *field = &view.fields[i];
+            ok = csv_reserve(&builder->values, &builder->values_cap,
+                    builder->values_len + field->len + 1, 1);
+            if (ok) {
+                builder->fields[builder->num_fields++] = builder->values_len;
+                memcpy(builder->values + builder->values_len, field->data,
+                        field->len);
+                builder->values_len += field->len;
+                builder->values[builder->values_len++] = '\0';
+            }
+        }
+        if (!ok) {
+            break;
+        }
+    }
+
+    builder->lines = scan.lines;
+    free(view.fields);
+    free(line);
+
+    return ok;
+}
+
+
+/**
+ * @brief Write a cache in its place
+ *
+ * @param builder Cache to write
+ * @param head    Header of the cache file
+ * @param path    Path to the CSV file
+ * @param dir     Cache directory, or @c NULL
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_cache_write(const csv_cache_builder_td *builder,
+        const uint64_t *head, const char *path, const char *dir)
+{
+    char *cache_path = s_cache_path(path, dir, CSV_CACHE_SUFFIX);
+    char *tmp_path = s_cache_path(path, dir, CSV_CACHE_SUFFIX ".tmp");
+    bool ok = false;
+
+    /* A sentinel past the last record and field gives their ends, and
+     * the lines of the whole file */
+    csv_cache_record_td last = { head[1], head[1], builder->lines,
+        builder->num_fields };
+    uint64_t values_len = builder->values_len;
+
+    FILE *fp = (cache_path && tmp_path) ? fopen(tmp_path, "wb") : NULL;
+    if (fp != NULL) {
+        ok = fwrite(head, sizeof(uint64_t), CSV_CACHE_HEAD, fp) ==
+            CSV_CACHE_HEAD &&
+            (builder->num_records == 0 ||
+             fwrite(builder->records, sizeof(csv_cache_record_td),
+                 builder->num_records, fp) == builder->num_records) &&
+            fwrite(&last, sizeof(last), 1, fp) == 1 &&
+            (builder->num_fields == 0 ||
+             fwrite(builder->fields, sizeof(uint64_t), builder->num_fields,
+                 fp) == builder->num_fields) &&
+            fwrite(&values_len, sizeof(values_len), 1, fp) == 1 &&
+            (builder->values_len == 0 ||
+             fwrite(builder->values, 1, builder->values_len, fp) ==
+             builder->values_len);
+        ok = (fclose(fp) == 0) && ok;
+        ok = ok && rename(tmp_path, cache_path) == 0;
+        if (!ok) {
+            remove(tmp_path);
+        }
+    }
+
+    free(cache_path);
+    free(tmp_path);
+
+    return ok;
+}
+
+
+/**
+ * @brief Hash the first block of a CSV file
+ *
+ * @param fd   File descriptor of the CSV file
+ * @param size Size of the file
+ * @param hash Where to store the hash
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_block_hash(int fd, uint64_t size, uint64_t *hash)
+{
+    size_t len = (size < CSV_CACHE_BLOCK) ? (size_t) size : CSV_CACHE_BLOCK;
+    char *block = malloc(len + 1);
+    bool ok = (block != NULL &&
+            pread(fd, block, len, 0) == (ssize_t) len);
+
+    if (ok) {
+        *hash = csv_hash_bytes(block, len);
+    }
+    free(block);
+
+    return ok;
+}
+
+
+/* Build the parse cache of a CSV file */
+bool csv_cache_build(const char *path, const char *delim, const char *dir)
+{
+    csv_cache_builder_td builder;
+    uint64_t head[CSV_CACHE_HEAD];
+    struct stat st;
+    char *data = NULL;
+    bool ok = false;
+
+    if (path == NULL) {
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t) st.st_size;
+    if (size > 0) {
+        data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        (void) posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+    }
+
+    char delim_c = csv_parser_delim(delim);
+    memset(&builder, 0, sizeof(builder));
+    memcpy(&head[0], CSV_CACHE_MAGIC, sizeof(uint64_t));
+    head[1] = (uint64_t) size;
+    head[2] = (uint64_t) st.st_mtim.tv_sec;
+    head[3] = (uint64_t) st.st_mtim.tv_nsec;
+    head[4] = csv_hash_bytes(data,
+            (size < CSV_CACHE_BLOCK) ? size : CSV_CACHE_BLOCK);
+    head[5] = csv_hash_bytes(path, strlen(path));
+    head[6] = (unsigned char) delim_c |
+        ((size > 0 && data[size - 1] == '\n') ? 0x100u : 0u);
+
+    if (s_cache_scan(&builder, data, size, delim_c)) {
+        head[7] = builder.num_records;
+        head[8] = builder.num_fields;
+        head[9] = builder.values_len;
+        ok = s_cache_write(&builder, head, path, dir);
+    }
+
+    if (data != NULL) {
+        munmap(data, size);
+    }
+    close(fd);
+    free(builder.records);
+    free(builder.fields);
+    free(builder.values);
+
+    return ok;
+}
+
+
+/**
+ * @brief Tell whether the arrays of a mapped cache are consistent
+ *
+ * Every index and offset is checked once, so that a corrupt cache can't
+ * make a parser read out of the mapping.
+ *
+ * @param cache      Cache to check
+ * @param values_len Number of bytes of its values
+ *
+ * @return @c true if they are, @c false otherwise
+ */
+static bool s_cache_valid(const csv_cache_td *cache, uint64_t values_len)
+{
+    const csv_cache_record_td *records = cache->records;
+    const uint64_t *fields = cache->fields;
+
+    /* Records follow each other up to the sentinel at the end of the
+     * file, and each one has at least a field */
+    if (records[0].field != 0 ||
+            records[cache->num_records].end != cache->size ||
+            records[cache->num_records].field != cache->num_fields) {
+        return false;
+    }
+    for (size_t i = 0; i < cache->num_records; ++i) {
+        if (records[i].offset > records[i].end ||
+                records[i].end > records[i + 1].offset ||
+                records[i].lines > records[i + 1].lines ||
+                records[i].field >= records[i + 1].field) {
+            return false;
+        }
+    }
+
+    /* Values follow each other up to the sentinel, each one ended by
+     * its null byte */
+    if (fields[0] != 0 || fields[cache->num_fields] != values_len) {
+        return false;
+    }
+    for (size_t i = 0; i < cache->num_fields; ++i) {
+        if (fields[i] >= fields[i + 1] ||
+                cache->values[fields[i + 1] - 1] != '\0') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* Load the parse cache of a CSV file */
+csv_cache_td *csv_cache_load(const char *path, char delim, const char *dir)
+{
+    struct stat st;
+    struct stat cache_st;
+    uint64_t hash;
+
+    if (path == NULL) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return NULL;
+    }
+    bool ok = (fstat(fd, &st) == 0 &&
+            s_block_hash(fd, (uint64_t) st.st_size, &hash));
+    close(fd);
+
+    char *cache_path = (ok) ? s_cache_path(path, dir, CSV_CACHE_SUFFIX) :
+        NULL;
+    fd = (cache_path) ? open(cache_path, O_RDONLY) : -1;
+    free(cache_path);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    /* Map the whole cache; the header tells how long it has to be */
+    void *map = MAP_FAILED;
+    size_t map_len = 0;
+    if (fstat(fd, &cache_st) == 0 &&
+            cache_st.st_size >= (off_t) (CSV_CACHE_HEAD * sizeof(uint64_t))) {
+        map_len = (size_t) cache_st.st_size;
+        map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    const uint64_t *head = map;
+    size_t body = map_len - CSV_CACHE_HEAD * sizeof(uint64_t);
+    ok = memcmp(&head[0], CSV_CACHE_MAGIC, sizeof(uint64_t)) == 0 &&
+        head[1] == (uint64_t) st.st_size &&
+        head[2] == (uint64_t) st.st_mtim.tv_sec &&
+        head[3] == (uint64_t) st.st_mtim.tv_nsec &&
+        head[4] == hash &&
+        (dir == NULL || head[5] == csv_hash_bytes(path, strlen(path))) &&
+        (head[6] & 0xffu) == (unsigned char) delim &&
+        head[7] < body / sizeof(csv_cache_record_td) &&
+        head[8] < body / sizeof(uint64_t) &&
+        (head[7] + 1) * sizeof(csv_cache_record_td) +
+        (head[8] + 1) * sizeof(uint64_t) + head[9] == body;
+
+    csv_cache_td *cache = (ok) ? malloc(sizeof(csv_cache_td)) : NULL;
+    if (cache == NULL) {
+        munmap(map, map_len);
+        return NULL;
+    }
+
+    cache->map = map;
+    cache->map_len = map_len;
+    cache->size = head[1];
+    cache->last_newline = (head[6] & 0x100u) != 0;
+    cache->delim = delim;
+    cache->num_records = (size_t) head[7];
+    cache->num_fields = (size_t) head[8];
+    cache->records = (const csv_cache_record_td *) (head + CSV_CACHE_HEAD);
+    cache->fields = (const uint64_t *) (cache->records +
+            cache->num_records + 1);
+    cache->values = (const char *) (cache->fields + cache->num_fields + 1);
+
+    if (!s_cache_valid(cache, head[9])) {
+        csv_cache_destroy(cache);
+        return NULL;
+    }
+    (void) posix_madvise(map, map_len, POSIX_MADV_SEQUENTIAL);
+
+    return cache;
+}
+
+
+/* Unmap and deallocate a cache */
+void csv_cache_destroy(csv_cache_td *cache)
+{
+    if (cache != NULL) {
+        munmap(cache->map, cache->map_len);
+        free(cache);
+    }
+}
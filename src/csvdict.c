@@ -0,0 +1,246 @@
+/**
+ * @file csvdict.c
+ *
+ * @brief Dictionary encoding of CSV values implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* System includes */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* uint32_t, uint64_t */
+#include <stdlib.h>     /* malloc, realloc, calloc, free, NULL */
+#include <string.h>     /* memcpy, memcmp */
+
+/* Local includes */
+#include <csvdict.h>
+#include <csvutil.h>
+
+
+/**
+ * @brief Find the slot of a value in the hash table
+ *
+ * @param csv_dict Dictionary where to look for the value
+ * @param h        Hash of the value
+ * @param data     Bytes of the value
+ * @param len      Number of bytes of the value
+ *
+ * @return Slot holding the value, or the empty slot where it belongs
+ */
+static size_t s_find_slot(const csv_dict_td *csv_dict, uint64_t h,
+        const char *data, size_t len)
+{
+    size_t mask = csv_dict->table_cap - 1;
+    size_t slot = (size_t) h & mask;
+
+    /* Linear probing; the table is never more than half full */
+    while (csv_dict->table[slot] != 0) {
+        size_t code = csv_dict->table[slot] - 1;
+        if (csv_dict->hashes[code] == h) {
+            size_t start = csv_dict->offsets[code];
+            size_t end = csv_dict->offsets[code + 1] - 1;
+            if (end - start == len &&
+                    memcmp(csv_dict->values + start, data, len) == 0) {
+                return slot;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+
+/**
+ * @brief Double the number of slots of the hash table
+ *
+ * @param csv_dict Dictionary whose table has to grow
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_grow_table(csv_dict_td *csv_dict)
+{
+    size_t cap = csv_dict->table_cap * 2;
+    uint32_t *table = calloc(cap, sizeof(uint32_t));
+    if (table == NULL) {
+        return false;
+    }
+
+    for (size_t code = 0; code < csv_dict->num_values; ++code) {
+        size_t slot = (size_t) csv_dict->hashes[code] & (cap - 1);
+        while (table[slot] != 0) {
+            slot = (slot + 1) & (cap - 1);
+        }
+        table[slot] = (uint32_t) (code + 1);
+    }
+
+    free(csv_dict->table);
+    csv_dict->table = table;
+    csv_dict->table_cap = cap;
+
+    return true;
+}
+
+
+/* Initialize an empty dictionary */
+csv_dict_td *csv_dict_init(void)
+{
+    csv_dict_td *csv_dict = malloc(sizeof(csv_dict_td));
+    if (csv_dict == NULL) {
+        return NULL;
+    }
+
+    csv_dict->values = NULL;
+    csv_dict->values_len = 0;
+    csv_dict->values_cap = 0;
+    csv_dict->num_values = 0;
+    csv_dict->values_max = 16;
+    csv_dict->table_cap = 32;
+    csv_dict->offsets = malloc(sizeof(size_t) * (csv_dict->values_max + 1));
+    csv_dict->hashes = malloc(sizeof(uint64_t) * csv_dict->values_max);
+    csv_dict->table = calloc(csv_dict->table_cap, sizeof(uint32_t));
+    if (csv_dict->offsets == NULL || csv_dict->hashes == NULL ||
+            csv_dict->table == NULL) {
+        csv_dict_destroy(csv_dict);
+        return NULL;
+    }
+    csv_dict->offsets[0] = 0;
+
+    return csv_dict;
+}
+
+
+/* Deallocate the memory used by a dictionary */
+void csv_dict_destroy(csv_dict_td *csv_dict)
+{
+    if (csv_dict == NULL) {
+        return;
+    }
+
+    free(csv_dict->values);
+    free(csv_dict->offsets);
+    free(csv_dict->hashes);
+    free(csv_dict->table);
+    free(csv_dict);
+}
+
+
+/* Get the code of a value, adding it if it's new */
+uint32_t csv_dict_intern(csv_dict_td *csv_dict, const char *data,
+        size_t len)
+{
+    if (csv_dict == NULL || (data == NULL && len > 0)) {
+        return CSV_DICT_NO_CODE;
+    }
+
+    uint64_t h = csv_hash_bytes(data, len);
+    size_t slot = s_find_slot(csv_dict, h, data, len);
+    if (csv_dict->table[slot] != 0) {
+        return csv_dict->table[slot] - 1;
+    }
+
+    /* New value */
+    if (csv_dict->num_values >= (size_t) CSV_DICT_NO_CODE - 1) {
+        return CSV_DICT_NO_CODE;
+    }
+
+    if (csv_dict->num_values == csv_dict->values_max) {
+        size_t max = csv_dict->values_max * 2;
+        size_t *offsets =
+            realloc(csv_dict->offsets, sizeof(size_t) * (max + 1));
+        if (offsets == NULL) {
+            return CSV_DICT_NO_CODE;
+        }
+        csv_dict->offsets = offsets;
+        uint64_t *hashes = realloc(csv_dict->hashes, sizeof(uint64_t) * max);
+        if (hashes == NULL) {
+            return CSV_DICT_NO_CODE;
+        }
+        csv_dict->hashes = hashes;
+        csv_dict->values_max = max;
+    }
+
+    if (csv_dict->values_len + len + 1 > csv_dict->values_cap) {
+        size_t cap = (csv_dict->values_cap) ? csv_dict->values_cap : 256;
+        while (cap < csv_dict->values_len + len + 1) {
+            cap *= 2;
+        }
+        char *values = realloc(csv_dict->values, cap);
+        if (values == NULL) {
+            return CSV_DICT_NO_CODE;
+        }
+        csv_dict->values = values;
+        csv_dict->values_cap = cap;
+    }
+
+    size_t code = csv_dict->num_values++;
+    if (len > 0) {
+        memcpy(csv_dict->values + csv_dict->values_len, data, len);
+    }
+    csv_dict->values_len += len;
+    csv_dict->values[csv_dict->values_len++] = '\0';
+    csv_dict->offsets[code + 1] = csv_dict->values_len;
+    csv_dict->hashes[code] = h;
+    csv_dict->table[slot] = (uint32_t) (code + 1);
+
+    /* Keep the table at most half full, so that probes stay short; if
+     * it can't grow now, it'll be retried with the next new value */
+    if (2 * csv_dict->num_values > csv_dict->table_cap) {
+        (void) s_grow_table(csv_dict);
+    }
+
+    return (uint32_t) code;
+}
+
+
+/* Get the code of a value, without adding it */
+uint32_t csv_dict_find(const csv_dict_td *csv_dict, const char *data,
+        size_t len)
+{
+    if (csv_dict == NULL || (data == NULL && len > 0)) {
+        return CSV_DICT_NO_CODE;
+    }
+
+    size_t slot = s_find_slot(csv_dict, csv_hash_bytes(data, len), data, len);
+
+    return (csv_dict->table[slot] != 0) ?
+        csv_dict->table[slot] - 1 : CSV_DICT_NO_CODE;
+}
+
+
+/* Get the value of a code */
+const char *csv_dict_value(const csv_dict_td *csv_dict, uint32_t code,
+        size_t *len)
+{
+    if (csv_dict == NULL || code >= csv_dict->num_values) {
+        return NULL;
+    }
+
+    size_t start = csv_dict->offsets[code];
+    if (len != NULL) {
+        *len = csv_dict->offsets[code + 1] - start - 1;
+    }
+
+    return csv_dict->values + start;
+}
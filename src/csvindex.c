@@ -0,0 +1,314 @@
+/**
+ * @file csvindex.c
+ *
+ * @brief Persistent sidecar row index implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <fcntl.h>      /* open, O_RDONLY */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* uint64_t, int64_t */
+#include <stdio.h>      /* FILE, fopen, fread, fileno, rename, remove */
+#include <stdlib.h>     /* malloc, realloc, free, NULL */
+#include <string.h>     /* memcpy, strlen */
+#include <sys/mman.h>   /* mmap, munmap, posix_madvise */
+#include <sys/stat.h>   /* stat, fstat, S_ISREG */
+#include <unistd.h>     /* close */
+
+/* Local includes */
+#include <csvindex.h>
+#include <csvparser.h>
+
+
+/* First bytes of an index file; also tells the byte order apart */
+#define CSV_INDEX_MAGIC "CSVIDX01"
+
+/* Number of 64-bit words of the header of an index file */
+#define CSV_INDEX_HEAD 8
+
+
+/**
+ * @brief Get the path of a file next to a CSV file
+ *
+ * @param path   Path to the CSV file
+ * @param suffix Suffix to append to @p path
+ *
+ * @return Newly allocated path, or @c NULL on allocation failure
+ */
+static char *s_sidecar_path(const char *path, const char *suffix)
+{
+    size_t len = strlen(path);
+    size_t suffix_len = strlen(suffix);
+    char *sidecar = malloc(len + suffix_len + 1);
+
+    if (sidecar != NULL) {
+        memcpy(sidecar, path, len);
+        memcpy(sidecar + len, suffix, suffix_len + 1);
+    }
+
+    return sidecar;
+}
+
+
+/**
+ * @brief Sample the position of every @e K-th record of a buffer
+ *
+ * The sample of a record is the scanner position right after the
+ * previous record, so that resuming there in @c CSV_SCAN_LINE_START
+ * also skips the blank and comment lines before it, and counts them.
+ *
+ * @param index Index where to store the samples
+ * @param data  Contents of the CSV file
+ * @param size  Size of @p data
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_index_scan(csv_index_td *index, const char *data, size_t size)
+{
+    csv_scan_td scan;
+    csv_span_td span;
+    size_t cap = 0;
+
+    csv_scan_init(&scan, index->delim, CSV_SCAN_LINE_START, 0);
+    for (;;) {
+        bool sampled = (index->num_records % index->every == 0);
+        if (sampled) {
+            if (index->num_samples == cap) {
+                cap = (cap) ? cap * 2 : 256;
+                csv_index_sample_td *samples = realloc(index->samples,
+                        sizeof(csv_index_sample_td) * cap);
+                if (samples == NULL) {
+                    return false;
+                }
+                index->samples = samples;
+            }
+            index->samples[index->num_samples].offset = scan.pos;
+            index->samples[index->num_samples].lines = scan.lines;
+            index->num_samples++;
+        }
+
+        if (csv_scan(&scan, data, size, &span, 1) == 0 &&
+                !csv_scan_flush(&scan, &span)) {
+            /* No record there after all */
+            index->num_samples -= (sampled) ? 1 : 0;
+            return true;
+        }
+        index->num_records++;
+    }
+}
+
+
+/**
+ * @brief Write an index next to its CSV file
+ *
+ * @param index Index to write
+ * @param path  Path to the CSV file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_index_write(const csv_index_td *index, const char *path)
+{
+    uint64_t head[CSV_INDEX_HEAD];
+    char *idx_path = s_sidecar_path(path, CSV_INDEX_SUFFIX);
+    char *tmp_path = s_sidecar_path(path, CSV_INDEX_SUFFIX ".tmp");
+    bool ok = false;
+
+    memcpy(&head[0], CSV_INDEX_MAGIC, sizeof(uint64_t));
+    head[1] = index->size;
+    head[2] = (uint64_t) index->mtime_sec;
+    head[3] = (uint64_t) index->mtime_nsec;
+    head[4] = index->every;
+    head[5] = index->num_records;
+    head[6] = index->num_samples;
+    head[7] = (unsigned char) index->delim;
+
+    FILE *fp = (idx_path && tmp_path) ? fopen(tmp_path, "wb") : NULL;
+    if (fp != NULL) {
+        ok = fwrite(head, sizeof(uint64_t), CSV_INDEX_HEAD, fp) ==
+            CSV_INDEX_HEAD && fwrite(index->samples,
+                    sizeof(csv_index_sample_td), index->num_samples, fp) ==
+            index->num_samples;
+        ok = (fclose(fp) == 0) && ok;
+        ok = ok && rename(tmp_path, idx_path) == 0;
+        if (!ok) {
+            remove(tmp_path);
+        }
+    }
+
+    free(idx_path);
+    free(tmp_path);
+
+    return ok;
+}
+
+
+/* Build the sidecar index of a CSV file */
+bool csv_index_build(const char *path, const char *delim)
+{
+    csv_index_td index = { 0, 0, 0, CSV_INDEX_EVERY, 0, ',', NULL, 0 };
+    struct stat st;
+    void *data = NULL;
+    bool ok = false;
+
+    if (path == NULL) {
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    index.size = (uint64_t) st.st_size;
+    index.mtime_sec = (int64_t) st.st_mtim.tv_sec;
+    index.mtime_nsec = (int64_t) st.st_mtim.tv_nsec;
+    index.delim = csv_parser_delim(delim);
+
+    if (index.size > 0) {
+        data = mmap(NULL, (size_t) index.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        (void) posix_madvise(data, (size_t) index.size,
+                POSIX_MADV_SEQUENTIAL);
+    }
+
+    if (s_index_scan(&index, data, (size_t) index.size)) {
+        ok = s_index_write(&index, path);
+    }
+
+    if (data != NULL) {
+        munmap(data, (size_t) index.size);
+    }
+    close(fd);
+    free(index.samples);
+
+    return ok;
+}
+
+
+/**
+ * @brief Tell whether the samples of a loaded index are consistent
+ *
+ * Each sample must lie within the indexed file, after the one before it,
+ * since every record takes at least one byte.
+ *
+ * @param index Index to check
+ *
+ * @return @c true if they are, @c false otherwise
+ */
+static bool s_index_samples_valid(const csv_index_td *index)
+{
+    for (size_t i = 0; i < index->num_samples; ++i) {
+        if (index->samples[i].offset > index->size ||
+                (i > 0 && index->samples[i].offset <=
+                 index->samples[i - 1].offset)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* Load the sidecar index of a CSV file */
+csv_index_td *csv_index_load(const char *path, char delim)
+{
+    uint64_t head[CSV_INDEX_HEAD];
+    struct stat st;
+    struct stat idx_st;
+
+    if (path == NULL || stat(path, &st) == -1) {
+        return NULL;
+    }
+
+    char *idx_path = s_sidecar_path(path, CSV_INDEX_SUFFIX);
+    FILE *fp = (idx_path) ? fopen(idx_path, "rb") : NULL;
+    free(idx_path);
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    csv_index_td *index = NULL;
+    if (fread(head, sizeof(uint64_t), CSV_INDEX_HEAD, fp) == CSV_INDEX_HEAD &&
+            memcmp(&head[0], CSV_INDEX_MAGIC, sizeof(uint64_t)) == 0 &&
+            head[1] == (uint64_t) st.st_size &&
+            head[2] == (uint64_t) st.st_mtim.tv_sec &&
+            head[3] == (uint64_t) st.st_mtim.tv_nsec &&
+            head[4] > 0 &&
+            head[6] == head[5] / head[4] + ((head[5] % head[4]) ? 1 : 0) &&
+            head[7] == (unsigned char) delim &&
+            fstat(fileno(fp), &idx_st) == 0 &&
+            (uint64_t) idx_st.st_size >= sizeof(head)) {
+        /* The samples must fill the rest of the file exactly, so that a
+         * corrupt count can't size the allocation below */
+        uint64_t body = (uint64_t) idx_st.st_size - sizeof(head);
+        if (head[6] <= body / sizeof(csv_index_sample_td) &&
+                head[6] * sizeof(csv_index_sample_td) == body) {
+            index = malloc(sizeof(csv_index_td));
+        }
+    }
+
+    if (index != NULL) {
+        index->size = head[1];
+        index->mtime_sec = (int64_t) head[2];
+        index->mtime_nsec = (int64_t) head[3];
+        index->every = head[4];
+        index->num_records = head[5];
+        index->num_samples = (size_t) head[6];
+        index->delim = delim;
+        index->samples = malloc(sizeof(csv_index_sample_td) *
+                (index->num_samples + 1));
+        if (index->samples == NULL ||
+                fread(index->samples, sizeof(csv_index_sample_td),
+                    index->num_samples, fp) != index->num_samples ||
+                !s_index_samples_valid(index)) {
+            csv_index_destroy(index);
+            index = NULL;
+        }
+    }
+    fclose(fp);
+
+    return index;
+}
+
+
+/* Deallocate an index */
+void csv_index_destroy(csv_index_td *index)
+{
+    if (index != NULL) {
+        free(index->samples);
+        free(index);
+    }
+}
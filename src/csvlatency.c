@@ -0,0 +1,156 @@
+/**
+ * @file csvlatency.c
+ *
+ * @brief Latency histograms implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* System includes */
+#include <stdint.h>     /* uint64_t, UINT64_C */
+#include <string.h>     /* memset */
+
+/* Local includes */
+#include <csvlatency.h>
+
+
+/**
+ * @brief Get the bucket of a value
+ *
+ * Values below @c CSV_LATENCY_SUB have a bucket each; a value with its
+ * highest bit set at position @c e falls into one of the
+ * @c CSV_LATENCY_SUB buckets of [2^e, 2^(e + 1)), selected by the
+ * @c CSV_LATENCY_SUB_BITS bits below the highest one.
+ *
+ * @param value Value to classify
+ *
+ * @return Index of the bucket
+ */
+static size_t s_bucket(uint64_t value)
+{
+    if (value < CSV_LATENCY_SUB) {
+        return (size_t) value;
+    }
+
+    unsigned e = 63u - (unsigned) __builtin_clzll(value);
+    if (e > CSV_LATENCY_MAX_EXP) {
+        return CSV_LATENCY_BUCKETS - 1;
+    }
+
+    size_t sub = (size_t) (value >> (e - CSV_LATENCY_SUB_BITS)) &
+        (CSV_LATENCY_SUB - 1);
+
+    return (e - CSV_LATENCY_SUB_BITS + 1) * CSV_LATENCY_SUB + sub;
+}
+
+
+/**
+ * @brief Get the highest value that falls into a bucket
+ *
+ * @param bucket Index of the bucket
+ *
+ * @return Highest value of the bucket
+ */
+static uint64_t s_bucket_top(size_t bucket)
+{
+    if (bucket < CSV_LATENCY_SUB) {
+        return (uint64_t) bucket;
+    }
+
+    unsigned e = (unsigned) (bucket / CSV_LATENCY_SUB) +
+        CSV_LATENCY_SUB_BITS - 1;
+    uint64_t sub = (uint64_t) (bucket % CSV_LATENCY_SUB);
+    unsigned shift = e - CSV_LATENCY_SUB_BITS;
+
+    return ((CSV_LATENCY_SUB + sub + 1) << shift) - 1;
+}
+
+
+/* Remove all the values of a histogram */
+void csv_latency_reset(csv_latency_td *latency)
+{
+    if (latency != NULL) {
+        memset(latency, 0, sizeof(*latency));
+    }
+}
+
+
+/* Record a value in a histogram */
+void csv_latency_record(csv_latency_td *latency, uint64_t value)
+{
+    latency->counts[s_bucket(value)]++;
+    latency->count++;
+    if (value > latency->max) {
+        latency->max = value;
+    }
+}
+
+
+/* Get a percentile of the values of a histogram */
+uint64_t csv_latency_percentile(const csv_latency_td *latency,
+        double percentile)
+{
+    if (latency == NULL || latency->count == 0) {
+        return 0;
+    }
+
+    /* Rank of the value, from 1 to the number of values */
+    double rank = percentile / 100.0 * (double) latency->count;
+    uint64_t target = (rank < 1.0) ? 1 : (uint64_t) rank;
+    if ((double) target < rank) {
+        target++;
+    }
+    if (target > latency->count) {
+        target = latency->count;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < CSV_LATENCY_BUCKETS; ++i) {
+        seen += latency->counts[i];
+        if (seen >= target) {
+            uint64_t top = s_bucket_top(i);
+            return (top < latency->max && i + 1 < CSV_LATENCY_BUCKETS) ?
+                top : latency->max;
+        }
+    }
+
+    return latency->max;
+}
+
+
+/* Get the usual percentiles of a histogram */
+csv_latency_summary_td csv_latency_summary(const csv_latency_td *latency)
+{
+    csv_latency_summary_td summary = { 0, 0, 0, 0, 0 };
+
+    if (latency != NULL) {
+        summary.count = latency->count;
+        summary.p50 = csv_latency_percentile(latency, 50.0);
+        summary.p99 = csv_latency_percentile(latency, 99.0);
+        summary.p999 = csv_latency_percentile(latency, 99.9);
+        summary.max = latency->max;
+    }
+
+    return summary;
+}
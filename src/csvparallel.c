@@ -0,0 +1,905 @@
+/**
+ * @file csvparallel.c
+ *
+ * @brief Parallel chunked parsing of a single CSV file implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <fcntl.h>      /* open, O_RDONLY */
+#include <pthread.h>    /* pthread_* */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdlib.h>     /* malloc, free, NULL */
+#include <string.h>     /* memchr, memcpy */
+#include <sys/mman.h>   /* mmap, munmap, posix_madvise */
+#include <sys/stat.h>   /* fstat */
+#include <unistd.h>     /* close, sysconf */
+
+/* Local includes */
+#include <csvparallel.h>
+#include <csvparser.h>
+#include <csvutil.h>
+
+
+/**
+ * @brief Find the end of the chunk that starts at a given offset
+ *
+ * @param csv_parallel Parallel CSV parser
+ * @param begin        Offset where the chunk starts
+ *
+ * @return Offset right after the first newline past the nominal size of
+ *         a chunk, or the size of the file
+ */
+static size_t s_chunk_end(const csv_parallel_td *csv_parallel, size_t begin)
+{
+    size_t nominal = begin + csv_parallel->chunk_size;
+    if (nominal >= csv_parallel->size) {
+        return csv_parallel->size;
+    }
+
+    const char *nl = memchr(csv_parallel->data + nominal, '\n',
+            csv_parallel->size - nominal);
+
+    return (nl) ? (size_t) (nl - csv_parallel->data) + 1 : csv_parallel->size;
+}
+
+
+/**
+ * @brief Locate the records of a chunk assuming a start state
+ *
+ * @param csv_parallel Parallel CSV parser
+ * @param chunk        Chunk to scan
+ * @param k            0 to start between records, 1 to start inside
+ *                     a quoted field
+ * @param last         Whether it's the last chunk of the file
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_chunk_scan(const csv_parallel_td *csv_parallel,
+        csv_chunk_td *chunk, int k, bool last)
+{
+    csv_scan_td scan;
+    size_t n;
+
+    csv_scan_init(&scan, csv_parallel->delim,
+            (k == 0) ? CSV_SCAN_LINE_START : CSV_SCAN_QUOTED, chunk->begin);
+    chunk->num_spans[k] = 0;
+
+    do {
+        if (!csv_reserve(&chunk->spans[k], &chunk->spans_cap[k],
+                    chunk->num_spans[k] + 1, sizeof(csv_span_td))) {
+            return false;
+        }
+        size_t room = chunk->spans_cap[k] - chunk->num_spans[k];
+        n = csv_scan(&scan, csv_parallel->data, chunk->end,
+                chunk->spans[k] + chunk->num_spans[k], room);
+        chunk->num_spans[k] += n;
+    } while (scan.pos < chunk->end);
+
+    if (last) {
+        csv_span_td span;
+        if (csv_scan_flush(&scan, &span)) {
+            if (!csv_reserve(&chunk->spans[k], &chunk->spans_cap[k],
+                        chunk->num_spans[k] + 1, sizeof(csv_span_td))) {
+                return false;
+            }
+            chunk->spans[k][chunk->num_spans[k]++] = span;
+        }
+    }
+
+    chunk->end_state[k] = scan.state;
+    chunk->tail_start[k] = scan.start;
+    chunk->scanned[k] = true;
+
+    return true;
+}
+
+
+/**
+ * @brief Split the records of a resolved chunk into fields
+ *
+ * @param csv_parallel Parallel CSV parser
+ * @param chunk        Chunk to parse
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_chunk_parse(const csv_parallel_td *csv_parallel,
+        csv_chunk_td *chunk)
+{
+    csv_span_td *spans = chunk->spans[chunk->sel];
+    size_t n = chunk->num_spans[chunk->sel];
+    csv_row_view_td view = { NULL, 0 };
+    size_t view_cap = 0;
+    size_t total = 0;
+    size_t num_fields = 0;
+
+    /* The first record of a chunk that starts inside a quoted field
+     * began in an earlier chunk */
+    if (chunk->sel == 1 && n > 0) {
+        spans[0].start = chunk->carry_start;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        total += spans[i].end - spans[i].start + 1;
+    }
+    if (!csv_reserve(&chunk->arena, &chunk->arena_cap, total, 1) ||
+            !csv_reserve(&chunk->first_field, &chunk->records_cap, n + 1,
+                sizeof(size_t))) {
+        return false;
+    }
+
+    char *record = chunk->arena;
+    for (size_t i = 0; i < n; ++i) {
+        size_t len = spans[i].end - spans[i].start;
+        memcpy(record, csv_parallel->data + spans[i].start, len);
+        record[(len > 0 && record[len - 1] == '\r') ? len - 1 : len] = '\0';
+
+        if (!csv_split_record(record, csv_parallel->delim, &view,
+                    &view_cap) ||
+                !csv_reserve(&chunk->fields, &chunk->fields_cap,
+                    num_fields + view.num_fields, sizeof(csv_field_td))) {
+            free(view.fields);
+            return false;
+        }
+        memcpy(chunk->fields + num_fields, view.fields,
+                sizeof(csv_field_td) * view.num_fields);
+        chunk->first_field[i] = num_fields;
+        num_fields += view.num_fields;
+        record += len + 1;
+    }
+    chunk->first_field[n] = num_fields;
+    chunk->num_records = n;
+
+    free(view.fields);
+
+    return true;
+}
+
+
+/**
+ * @brief Resolve the start state of the scanned chunks, in order
+ *
+ * The state at the start of a chunk is the state at the end of the
+ * previous one, using the scan that assumed the right start state for
+ * it; that's a single comparison per chunk.
+ *
+ * @param csv_parallel Parallel CSV parser (locked)
+ */
+static void s_resolve(csv_parallel_td *csv_parallel)
+{
+    for (;;) {
+        csv_chunk_td *chunk = &csv_parallel->chunks[csv_parallel->resolved_seq
+            % csv_parallel->window];
+        if (chunk->seq != csv_parallel->resolved_seq ||
+                chunk->status != CSV_CHUNK_SCANNED) {
+            break;
+        }
+
+        int k = (csv_parallel->resolve_state == CSV_SCAN_QUOTED) ? 1 : 0;
+        chunk->sel = k;
+        chunk->carry_start = csv_parallel->resolve_carry;
+
+        /* A record still open at the end continues in the next chunk;
+         * it started here unless this whole chunk was inside it */
+        if (chunk->end_state[k] == CSV_SCAN_QUOTED &&
+                (k == 0 || chunk->num_spans[k] > 0)) {
+            csv_parallel->resolve_carry = chunk->tail_start[k];
+        }
+        csv_parallel->resolve_state = chunk->end_state[k];
+
+        chunk->status = CSV_CHUNK_RESOLVED;
+        csv_parallel->resolved_seq++;
+    }
+
+    pthread_cond_broadcast(&csv_parallel->work_cond);
+}
+
+
+/**
+ * @brief Mark the parallel parser as failed and wake everyone up
+ *
+ * @param csv_parallel Parallel CSV parser (locked)
+ */
+static void s_fail(csv_parallel_td *csv_parallel)
+{
+    csv_parallel->failed = true;
+    pthread_cond_broadcast(&csv_parallel->work_cond);
+    pthread_cond_broadcast(&csv_parallel->ready_cond);
+}
+
+
+/**
+ * @brief Worker thread: scan, resolve and parse chunks
+ *
+ * @param arg Parallel CSV parser
+ *
+ * @return Always @c NULL
+ */
+static void *s_worker(void *arg)
+{
+    csv_parallel_td *csv_parallel = arg;
+
+    pthread_mutex_lock(&csv_parallel->lock);
+    while (!csv_parallel->stop && !csv_parallel->failed) {
+        csv_chunk_td *chunk = NULL;
+        if (csv_parallel->next_begin < csv_parallel->size) {
+            chunk = &csv_parallel->chunks[csv_parallel->next_seq %
+                csv_parallel->window];
+            if (chunk->status != CSV_CHUNK_FREE) {
+                chunk = NULL;
+            }
+        }
+        if (chunk == NULL) {
+            pthread_cond_wait(&csv_parallel->work_cond, &csv_parallel->lock);
+            continue;
+        }
+
+        chunk->seq = csv_parallel->next_seq++;
+        chunk->begin = csv_parallel->next_begin;
+        chunk->end = s_chunk_end(csv_parallel, chunk->begin);
+        chunk->status = CSV_CHUNK_SCANNING;
+        csv_parallel->next_begin = chunk->end;
+
+        /* If every earlier chunk is resolved, there's nothing to guess */
+        bool known = (chunk->seq == csv_parallel->resolved_seq);
+        int k = (csv_parallel->resolve_state == CSV_SCAN_QUOTED) ? 1 : 0;
+        bool last = (chunk->end == csv_parallel->size);
+        pthread_mutex_unlock(&csv_parallel->lock);
+
+        bool ok;
+        chunk->scanned[0] = chunk->scanned[1] = false;
+        if (known) {
+            ok = s_chunk_scan(csv_parallel, chunk, k, last);
+        } else {
+            ok = s_chunk_scan(csv_parallel, chunk, 0, last) &&
+                s_chunk_scan(csv_parallel, chunk, 1, last);
+        }
+
+        pthread_mutex_lock(&csv_parallel->lock);
+        if (!ok) {
+            s_fail(csv_parallel);
+            break;
+        }
+        chunk->status = CSV_CHUNK_SCANNED;
+        s_resolve(csv_parallel);
+        while (chunk->status != CSV_CHUNK_RESOLVED && !csv_parallel->stop &&
+                !csv_parallel->failed) {
+            pthread_cond_wait(&csv_parallel->work_cond, &csv_parallel->lock);
+        }
+        if (csv_parallel->stop || csv_parallel->failed) {
+            break;
+        }
+        chunk->status = CSV_CHUNK_PARSING;
+        pthread_mutex_unlock(&csv_parallel->lock);
+
+        ok = s_chunk_parse(csv_parallel, chunk);
+
+        pthread_mutex_lock(&csv_parallel->lock);
+        if (!ok) {
+            s_fail(csv_parallel);
+            break;
+        }
+        chunk->status = CSV_CHUNK_READY;
+        pthread_cond_broadcast(&csv_parallel->ready_cond);
+    }
+    pthread_mutex_unlock(&csv_parallel->lock);
+
+    return NULL;
+}
+
+
+/**
+ * @typedef csv_index_chunk_td
+ *
+ * @brief Structure for a chunk of a record index being built
+ */
+typedef struct {
+    const char *data;               /**< Buffer with the CSV data */
+    size_t begin;                   /**< Offset of the first byte */
+    size_t end;                     /**< Offset past the last byte */
+    char delim;                     /**< Delimiter between fields */
+    bool first;                     /**< Whether it starts the buffer */
+    bool last;                      /**< Whether it ends the buffer */
+    csv_scan_state_td end_state[2]; /**< State at the end per start state */
+    size_t tail_start[2];           /**< Start of the unfinished record */
+    size_t count[2];                /**< Records ending here */
+    int sel;                        /**< Real start state */
+    size_t carry_start;             /**< Start of a record that began in
+                                         an earlier chunk (if @e sel 1) */
+    csv_span_td *spans;             /**< Records of the chunk */
+    size_t num_spans;               /**< Number of records */
+    size_t spans_cap;               /**< Capacity of @e spans */
+    pthread_t thread;               /**< Thread running the current pass */
+    bool started;                   /**< Whether @e thread was created */
+    bool ok;                        /**< Whether the pass succeeded */
+} csv_index_chunk_td;
+
+
+/**
+ * @brief First pass: scanner state at the end of a chunk per start state
+ *
+ * Records are counted too (including an unterminated last one), so
+ * counting needs no second pass.
+ *
+ * @param arg Chunk of the record index
+ *
+ * @return Always @c NULL
+ */
+static void *s_index_carry(void *arg)
+{
+    csv_index_chunk_td *chunk = arg;
+
+    /* The first chunk always starts between records */
+    for (int k = 0; k < ((chunk->first) ? 1 : 2); ++k) {
+        csv_scan_td scan;
+        csv_scan_init(&scan, chunk->delim,
+                (k == 0) ? CSV_SCAN_LINE_START : CSV_SCAN_QUOTED,
+                chunk->begin);
+        chunk->count[k] = csv_scan(&scan, chunk->data, chunk->end, NULL,
+                (size_t) -1);
+        chunk->end_state[k] = scan.state;
+        chunk->tail_start[k] = scan.start;
+        if (chunk->last && csv_scan_flush(&scan, NULL)) {
+            chunk->count[k]++;
+        }
+    }
+    chunk->ok = true;
+
+    return NULL;
+}
+
+
+/**
+ * @brief Second pass: locate the records of a chunk from its real state
+ *
+ * @param arg Chunk of the record index
+ *
+ * @return Always @c NULL
+ */
+static void *s_index_spans(void *arg)
+{
+    csv_index_chunk_td *chunk = arg;
+    csv_scan_td scan;
+
+    chunk->ok = false;
+    chunk->num_spans = 0;
+    csv_scan_init(&scan, chunk->delim,
+            (chunk->sel == 0) ? CSV_SCAN_LINE_START : CSV_SCAN_QUOTED,
+            chunk->begin);
+
+    do {
+        if (!csv_reserve(&chunk->spans, &chunk->spans_cap,
+                    chunk->num_spans + 1, sizeof(csv_span_td))) {
+            return NULL;
+        }
+        chunk->num_spans += csv_scan(&scan, chunk->data, chunk->end,
+                chunk->spans + chunk->num_spans,
+                chunk->spans_cap - chunk->num_spans);
+    } while (scan.pos < chunk->end);
+
+    csv_span_td span;
+    if (chunk->last && csv_scan_flush(&scan, &span)) {
+        if (!csv_reserve(&chunk->spans, &chunk->spans_cap,
+                    chunk->num_spans + 1, sizeof(csv_span_td))) {
+            return NULL;
+        }
+        chunk->spans[chunk->num_spans++] = span;
+    }
+
+    if (chunk->sel == 1 && chunk->num_spans > 0) {
+        chunk->spans[0].start = chunk->carry_start;
+    }
+    chunk->ok = true;
+
+    return NULL;
+}
+
+
+/**
+ * @brief Run a pass over every chunk of a record index, one per thread
+ *
+ * The first chunk is run by the calling thread, as is any chunk whose
+ * thread can't be created.
+ *
+ * @param pass       Pass to run
+ * @param chunks     Chunks of the record index
+ * @param num_chunks Number of chunks
+ *
+ * @return @c true if the pass succeeded for every chunk
+ */
+static bool s_index_pass(void *(*pass)(void *), csv_index_chunk_td *chunks,
+        size_t num_chunks)
+{
+    bool ok = true;
+
+    for (size_t i = 1; i < num_chunks; ++i) {
+        chunks[i].started = (pthread_create(&chunks[i].thread, NULL, pass,
+                    &chunks[i]) == 0);
+        if (!chunks[i].started) {
+            pass(&chunks[i]);
+        }
+    }
+    pass(&chunks[0]);
+
+    for (size_t i = 0; i < num_chunks; ++i) {
+        if (i > 0 && chunks[i].started) {
+            pthread_join(chunks[i].thread, NULL);
+        }
+        ok = ok && chunks[i].ok;
+    }
+
+    return ok;
+}
+
+
+/**
+ * @brief Cut a buffer into a chunk per thread, ending after a newline
+ *
+ * @param data        Buffer with the CSV data
+ * @param begin       Offset of the first record
+ * @param size        Size of the buffer
+ * @param delim       Delimiter between fields
+ * @param num_threads Number of threads, or @c 0 to use one per online
+ *                    processor
+ * @param num_chunks  Where to store the number of chunks
+ *
+ * @return Newly allocated chunks, or @c NULL on allocation failure
+ */
+static csv_index_chunk_td *s_index_split(const char *data, size_t begin,
+        size_t size, char delim, size_t num_threads, size_t *num_chunks)
+{
+    if (num_threads == 0) {
+        num_threads = csv_parallel_num_cpus();
+    }
+
+    size_t nominal = (size - begin) / num_threads + 1;
+    csv_index_chunk_td *chunks =
+        calloc(num_threads, sizeof(csv_index_chunk_td));
+    if (chunks == NULL) {
+        return NULL;
+    }
+
+    *num_chunks = 0;
+    for (size_t at = begin; *num_chunks == 0 || at < size; ++*num_chunks) {
+        csv_index_chunk_td *chunk = &chunks[*num_chunks];
+        const char *nl = (at + nominal < size) ?
+            memchr(data + at + nominal, '\n', size - at - nominal) : NULL;
+
+        chunk->data = data;
+        chunk->delim = delim;
+        chunk->begin = at;
+        chunk->end = (nl) ? (size_t) (nl - data) + 1 : size;
+        chunk->first = (*num_chunks == 0);
+        chunk->last = (chunk->end == size);
+        at = chunk->end;
+    }
+
+    return chunks;
+}
+
+
+/**
+ * @brief Chain the carries of the chunks of a buffer
+ *
+ * The start state of a chunk is the end state of the previous one, from
+ * the scan that assumed its real start.
+ *
+ * @param chunks     Chunks of the buffer, after the first pass
+ * @param num_chunks Number of chunks
+ * @param begin      Offset of the first record
+ */
+static void s_index_chain(csv_index_chunk_td *chunks, size_t num_chunks,
+        size_t begin)
+{
+    csv_scan_state_td state = CSV_SCAN_LINE_START;
+    size_t carry = begin;
+
+    for (size_t i = 0; i < num_chunks; ++i) {
+        int k = (state == CSV_SCAN_QUOTED) ? 1 : 0;
+        chunks[i].sel = k;
+        chunks[i].carry_start = carry;
+        if (chunks[i].end_state[k] == CSV_SCAN_QUOTED &&
+                (k == 0 || chunks[i].count[k] > 0)) {
+            carry = chunks[i].tail_start[k];
+        }
+        state = chunks[i].end_state[k];
+    }
+}
+
+
+/* Get the number of online processors */
+size_t csv_parallel_num_cpus(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (size_t) n : 1;
+#else
+    return 1;
+#endif
+}
+
+
+/* Initialize an empty record index */
+void csv_record_index_init(csv_record_index_td *index)
+{
+    if (index != NULL) {
+        index->records = NULL;
+        index->num_records = 0;
+        index->cap = 0;
+    }
+}
+
+
+/* Deallocate the records of a record index */
+void csv_record_index_destroy(csv_record_index_td *index)
+{
+    if (index != NULL) {
+        free(index->records);
+        csv_record_index_init(index);
+    }
+}
+
+
+/* Locate every record of a buffer using several threads */
+bool csv_record_index_build(csv_record_index_td *index, const char *data,
+        size_t begin, size_t size, char delim, size_t num_threads)
+{
+    if (index == NULL || (data == NULL && size > 0) || begin > size) {
+        return false;
+    }
+
+    index->num_records = 0;
+
+    size_t num_chunks;
+    csv_index_chunk_td *chunks = s_index_split(data, begin, size, delim,
+            num_threads, &num_chunks);
+    if (chunks == NULL) {
+        return false;
+    }
+
+    bool ok = s_index_pass(s_index_carry, chunks, num_chunks);
+    if (ok) {
+        s_index_chain(chunks, num_chunks, begin);
+    }
+    ok = ok && s_index_pass(s_index_spans, chunks, num_chunks);
+
+    size_t total = 0;
+    for (size_t i = 0; ok && i < num_chunks; ++i) {
+        total += chunks[i].num_spans;
+    }
+    ok = ok && csv_reserve(&index->records, &index->cap, total,
+            sizeof(csv_span_td));
+    for (size_t i = 0; ok && i < num_chunks; ++i) {
+        if (chunks[i].num_spans == 0) {
+            /* No spans were allocated, nor maybe any records */
+            continue;
+        }
+        memcpy(index->records + index->num_records, chunks[i].spans,
+                sizeof(csv_span_td) * chunks[i].num_spans);
+        index->num_records += chunks[i].num_spans;
+    }
+
+    for (size_t i = 0; i < num_chunks; ++i) {
+        free(chunks[i].spans);
+    }
+    free(chunks);
+
+    return ok;
+}
+
+
+/* Count the records of a CSV file without parsing them */
+bool csv_count_records(const char *path, const char *delim, bool has_header,
+        size_t num_threads, size_t *count)
+{
+    struct stat st;
+    bool ok = false;
+
+    if (path == NULL || count == NULL) {
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t) st.st_size;
+    *count = 0;
+    if (size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    (void) posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+    size_t num_chunks;
+    csv_index_chunk_td *chunks = s_index_split(data, 0, size,
+            csv_parser_delim(delim), num_threads, &num_chunks);
+    if (chunks != NULL) {
+        ok = s_index_pass(s_index_carry, chunks, num_chunks);
+    }
+    if (ok) {
+        s_index_chain(chunks, num_chunks, 0);
+        for (size_t i = 0; i < num_chunks; ++i) {
+            *count += chunks[i].count[chunks[i].sel];
+        }
+        if (has_header && *count > 0) {
+            (*count)--;
+        }
+    }
+
+    free(chunks);
+    munmap(data, size);
+    close(fd);
+
+    return ok;
+}
+
+
+/**
+ * @brief Read the header and the dialect with a sequential parser
+ *
+ * @param csv_parallel Parallel CSV parser
+ * @param filename     Path to the CSV data file
+ * @param delim        Delimiter between fields
+ *
+ * @return Offset where the data starts (after the header, if any), or
+ *         @c -1 on error
+ */
+static off_t s_read_header(csv_parallel_td *csv_parallel,
+        const char *filename, const char *delim)
+{
+    off_t data_start = 0;
+    csv_parser_td *csv_parser =
+        csv_parser_init(filename, delim, csv_parallel->has_header);
+    if (csv_parser == NULL) {
+        return -1;
+    }
+
+    csv_parallel->delim = csv_parser->delim;
+    if (csv_parallel->has_header && csv_parser_header(csv_parser) != NULL) {
+        /* Take ownership of the header */
+        csv_parallel->header = csv_parser->header;
+        csv_parser->header = NULL;
+        data_start = csv_parser->buf_offset + (off_t) csv_parser->scan.pos;
+    }
+    csv_parser_destroy(csv_parser);
+
+    return data_start;
+}
+
+
+/* Initialize the parallel CSV parser and start its workers */
+csv_parallel_td *csv_parallel_init(const char *filename, const char *delim,
+        bool has_header, size_t num_threads)
+{
+    struct stat st;
+
+    if (filename == NULL) {
+        return NULL;
+    }
+
+    csv_parallel_td *csv_parallel = malloc(sizeof(csv_parallel_td));
+    if (csv_parallel == NULL) {
+        return NULL;
+    }
+
+    csv_parallel->fd = -1;
+    csv_parallel->data = NULL;
+    csv_parallel->size = 0;
+    csv_parallel->has_header = has_header;
+    csv_parallel->header = NULL;
+    csv_parallel->chunk_size = CSV_PARALLEL_CHUNK;
+    csv_parallel->threads = NULL;
+    csv_parallel->num_threads = 0;
+    csv_parallel->chunks = NULL;
+    csv_parallel->window = 0;
+    csv_parallel->next_seq = 0;
+    csv_parallel->resolved_seq = 0;
+    csv_parallel->resolve_state = CSV_SCAN_LINE_START;
+    csv_parallel->resolve_carry = 0;
+    csv_parallel->consume_seq = 0;
+    csv_parallel->current = NULL;
+    csv_parallel->consume_rec = 0;
+    csv_parallel->stop = false;
+    csv_parallel->failed = false;
+    csv_parallel->view.fields = NULL;
+    csv_parallel->view.num_fields = 0;
+    pthread_mutex_init(&csv_parallel->lock, NULL);
+    pthread_cond_init(&csv_parallel->work_cond, NULL);
+    pthread_cond_init(&csv_parallel->ready_cond, NULL);
+
+    off_t data_start = s_read_header(csv_parallel, filename, delim);
+    csv_parallel->fd = open(filename, O_RDONLY);
+    if (data_start < 0 || csv_parallel->fd == -1 ||
+            fstat(csv_parallel->fd, &st) == -1) {
+        csv_parallel_destroy(csv_parallel);
+        return NULL;
+    }
+
+    csv_parallel->size = (size_t) st.st_size;
+    csv_parallel->next_begin = (size_t) data_start;
+    if (csv_parallel->size > 0) {
+        void *data = mmap(NULL, csv_parallel->size, PROT_READ, MAP_PRIVATE,
+                csv_parallel->fd, 0);
+        if (data == MAP_FAILED) {
+            csv_parallel_destroy(csv_parallel);
+            return NULL;
+        }
+        csv_parallel->data = data;
+        (void) posix_madvise(data, csv_parallel->size,
+                POSIX_MADV_SEQUENTIAL);
+    }
+
+    if (num_threads == 0) {
+        num_threads = csv_parallel_num_cpus();
+    }
+
+    /* Enough chunks in flight to keep every worker busy while the
+     * consumer drains the oldest ones */
+    csv_parallel->window = 2 * num_threads;
+    csv_parallel->chunks = calloc(csv_parallel->window, sizeof(csv_chunk_td));
+    csv_parallel->threads = malloc(sizeof(pthread_t) * num_threads);
+    if (csv_parallel->chunks == NULL || csv_parallel->threads == NULL) {
+        csv_parallel_destroy(csv_parallel);
+        return NULL;
+    }
+    for (size_t i = 0; i < csv_parallel->window; ++i) {
+        csv_parallel->chunks[i].seq = (size_t) -1;
+        csv_parallel->chunks[i].status = CSV_CHUNK_FREE;
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        if (pthread_create(&csv_parallel->threads[i], NULL, s_worker,
+                    csv_parallel) != 0) {
+            break;
+        }
+        csv_parallel->num_threads++;
+    }
+    if (csv_parallel->num_threads == 0) {
+        csv_parallel_destroy(csv_parallel);
+        return NULL;
+    }
+
+    return csv_parallel;
+}
+
+
+/* Stop the workers and deallocate the parallel CSV parser */
+void csv_parallel_destroy(csv_parallel_td *csv_parallel)
+{
+    if (csv_parallel == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&csv_parallel->lock);
+    csv_parallel->stop = true;
+    pthread_cond_broadcast(&csv_parallel->work_cond);
+    pthread_cond_broadcast(&csv_parallel->ready_cond);
+    pthread_mutex_unlock(&csv_parallel->lock);
+
+    for (size_t i = 0; i < csv_parallel->num_threads; ++i) {
+        pthread_join(csv_parallel->threads[i], NULL);
+    }
+
+    for (size_t i = 0; csv_parallel->chunks && i < csv_parallel->window;
+            ++i) {
+        csv_chunk_td *chunk = &csv_parallel->chunks[i];
+        free(chunk->spans[0]);
+        free(chunk->spans[1]);
+        free(chunk->arena);
+        free(chunk->fields);
+        free(chunk->first_field);
+    }
+
+    if (csv_parallel->data != NULL) {
+        munmap((void *) csv_parallel->data, csv_parallel->size);
+    }
+    if (csv_parallel->fd != -1) {
+        close(csv_parallel->fd);
+    }
+
+    pthread_mutex_destroy(&csv_parallel->lock);
+    pthread_cond_destroy(&csv_parallel->work_cond);
+    pthread_cond_destroy(&csv_parallel->ready_cond);
+    csv_parser_destroy_row(csv_parallel->header);
+    free(csv_parallel->chunks);
+    free(csv_parallel->threads);
+    free(csv_parallel);
+}
+
+
+/* Get the header of the CSV file, if any */
+const csv_row_td *csv_parallel_header(csv_parallel_td *csv_parallel)
+{
+    return (csv_parallel) ? csv_parallel->header : NULL;
+}
+
+
+/* Get the next row without copying its fields */
+const csv_row_view_td *csv_parallel_row_view(csv_parallel_td *csv_parallel)
+{
+    if (csv_parallel == NULL) {
+        return NULL;
+    }
+
+    /* Fast path: the chunk being consumed is owned by this thread */
+    csv_chunk_td *chunk = csv_parallel->current;
+    while (chunk == NULL ||
+            csv_parallel->consume_rec == chunk->num_records) {
+        pthread_mutex_lock(&csv_parallel->lock);
+        if (chunk != NULL) {
+            chunk->status = CSV_CHUNK_FREE;
+            csv_parallel->consume_seq++;
+            csv_parallel->consume_rec = 0;
+            csv_parallel->current = chunk = NULL;
+            pthread_cond_broadcast(&csv_parallel->work_cond);
+        }
+        for (;;) {
+            csv_chunk_td *next = &csv_parallel->chunks[
+                csv_parallel->consume_seq % csv_parallel->window];
+            if (csv_parallel->failed ||
+                    (csv_parallel->consume_seq == csv_parallel->next_seq &&
+                     csv_parallel->next_begin >= csv_parallel->size)) {
+                pthread_mutex_unlock(&csv_parallel->lock);
+                return NULL;
+            }
+            if (next->seq == csv_parallel->consume_seq &&
+                    next->status == CSV_CHUNK_READY) {
+                csv_parallel->current = chunk = next;
+                break;
+            }
+            pthread_cond_wait(&csv_parallel->ready_cond, &csv_parallel->lock);
+        }
+        pthread_mutex_unlock(&csv_parallel->lock);
+    }
+
+    size_t i = csv_parallel->consume_rec++;
+    csv_parallel->view.fields = chunk->fields + chunk->first_field[i];
+    csv_parallel->view.num_fields =
+        chunk->first_field[i + 1] - chunk->first_field[i];
+
+    return &csv_parallel->view;
+}
+
+
+/* Get the next row */
+csv_row_td *csv_parallel_row(csv_parallel_td *csv_parallel)
+{
+    return csv_row_from_view(csv_parallel_row_view(csv_parallel));
+}
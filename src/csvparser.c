@@ -33,12 +33,42 @@
 /* System includes */
 #include <ctype.h>      /* isspace */
 #include <stdbool.h>    /* bool, true, false */
-#include <stdio.h>      /* FILE */
+#include <stdint.h>     /* uint64_t, UINT64_C */
+#include <stdio.h>      /* FILE, fopen, fread */
 #include <stdlib.h>     /* malloc, realloc, free, NULL, memcpy(?) */
-#include <string.h>     /* strdup, strlen(?) */
+#include <string.h>     /* strdup, strlen(?), memmove */
+#include <sys/stat.h>   /* stat, fstat */
+#include <sys/types.h>  /* off_t */
+#include <time.h>       /* clock_gettime, nanosleep */
+#include <unistd.h>     /* read, pread, close */
+#if defined(__linux__)
+#include <poll.h>       /* poll */
+#include <sys/inotify.h>    /* inotify_* */
+#endif
 
 /* Local includes */
 #include <csvparser.h>
+#include <csvtrace.h>
+#include <csvutil.h>
+
+
+/* Initial size of the read buffer */
+#ifndef CSV_READ_BUF
+#define CSV_READ_BUF (64 * 1024)
+#endif
+
+/* Interval between checks for appended data, without inotify (ms.) */
+#ifndef CSV_FOLLOW_POLL
+#define CSV_FOLLOW_POLL 100
+#endif
+
+/* Statements updating the counters; without CSV_STATS they're still
+ * type-checked, but discarded as dead code */
+#if defined(CSV_STATS)
+#define CSV_STAT(stmt) do { stmt; } while (0)
+#else
+#define CSV_STAT(stmt) do { if (0) { stmt; } } while (0)
+#endif
 
 
 /**
@@ -96,152 +126,127 @@ static char *s_ltrim(char *s)
 
 
 /**
- * @brief Test whether a line should be skipped (blank or comment)
+ * @brief Append a field slice to a row view, growing it if needed
  *
- * A line is skippable if, after removing leading whitespace, it is
- * empty or starts with the '#' character.  This is used to ignore
- * comment lines and blank lines before parsing.
+ * @param view     Row view where to append the field
+ * @param view_cap Pointer to the capacity of @e view->fields
+ * @param start    First byte of the (already unescaped) field
+ * @param end      One past the last byte of the field
+ * @param stats    Counters to update, or @c NULL
  *
- * @param s Null-terminated line buffer (may contain leading whitespace)
- *
- * @return true if the line should be skipped, false otherwise
+ * @return @c true on success, @c false on allocation failure
  */
-static bool s_line_is_skippable(const char *s)
+static bool s_view_push(csv_row_view_td *view, size_t *view_cap,
+        const char *start, const char *end, csv_stats_td *stats)
 {
-    while (*s && isspace((unsigned char) *s)) {
-        s++;
+    if (view->num_fields == *view_cap) {
+        size_t cap = (*view_cap) ? *view_cap * 2 : 8;
+        csv_field_td *fields = realloc(view->fields, sizeof(*fields) * cap);
+        if (fields == NULL) {
+            return false;
+        }
+        CSV_STAT(if (stats != NULL) {
+                    stats->allocs++;
+                    stats->alloc_bytes += sizeof(*fields) * cap;
+                });
+        view->fields = fields;
+        *view_cap = cap;
     }
 
-    return (*s == '\0' || *s == '#');
+    view->fields[view->num_fields].data = start;
+    view->fields[view->num_fields].len = (size_t) (end - start);
+    view->num_fields++;
+    CSV_STAT(if (stats != NULL) { stats->fields++; });
+
+    return true;
 }
 
 
 /**
- * @brief Parse a single null-terminated line into a @e csv_row_td
- *        structure
+ * @brief Split a single null-terminated line into field slices, in
+ *        place
  *
- * Parses a single line (terminated by @c NULL) into individual fields
+ * Splits a single line (terminated by @c NULL) into individual fields
  * according to a CSV-like grammar with support for quoted fields and
- * escaped quotes represented by two double-quotes.
+ * escaped quotes represented by two double-quotes.  Unescaping is done
+ * within @p line itself, and every field is null-terminated in place,
+ * so no per-field allocation takes place.
  *
- * @param line  Null-terminated input line to parse (no trailing newline)
- * @param delim Field delimiter character
+ * @param line     Null-terminated input line to split (no trailing
+ *                 newline); its contents are overwritten
+ * @param delim    Field delimiter character
+ * @param view     Row view to fill with slices pointing into @p line
+ * @param view_cap Pointer to the capacity of @e view->fields
+ * @param stats    Counters to update, or @c NULL
  *
- * @return Pointer to newly allocated @e csv_row_td on success
+ * @return @c true on success, @c false on allocation failure
  *
- * @note The returned @e csv_row_td and its fields are heap-allocated
- *       and must be freed with @a csv_parser_destroy_row().
- * @note Never returns @c NULL under normal allocation semantics
- *       (allocation failures terminate).
- * @note The parser is lenient with respect to line endings (caller
- *       should strip CR/LF before calling).
+ * @note The slices in @p view are valid as long as @p line is.
+ * @note Unescaped output never outgrows the consumed input (a closing
+ *       quote or delimiter always makes room for the terminator), so
+ *       the write cursor never overtakes the read cursor.
+ * @note The caller strips the line terminator (LF or CRLF); any other
+ *       carriage return is data, as the record scanner takes it.
  */
-static csv_row_td *s_parse_line_to_row(const char *line, char delim)
+static bool s_split_line(char *line, char delim, csv_row_view_td *view,
+        size_t *view_cap, csv_stats_td *stats)
 {
     enum { ST_FIELD, ST_QUOTED_FIELD, ST_QUOTE_IN_QUOTED } state = ST_FIELD;
-    size_t fields_cnt = 0;
-    size_t fields_cap = 8;  /* Initial capacity for the fields array */
-    char **fields = malloc(sizeof(char *) * fields_cap);
-    if (fields == NULL) {
-        return NULL;
-    }
+    const char *p = line;   /* Read cursor */
+    char *w = line;         /* Write cursor */
+    char *start = line;     /* Start of the current field */
 
-    size_t buf_cap = 128;
-    size_t buf_len = 0;
-    char *buf = malloc(buf_cap);
-    if (buf == NULL) {
-        return NULL;
-    }
+    view->num_fields = 0;
 
-    const unsigned char *p = (const unsigned char *) line;
     while (*p) {
-        unsigned char c = *p;
+        char c = *p;
 
         if (state == ST_FIELD) {
-            if (c == (unsigned char) delim) {
-                buf[buf_len] = '\0';
-                fields[fields_cnt++] = strdup((char *) buf);
-                buf_len = 0;
-                if (fields_cnt == fields_cap) {
-                    fields_cap *= 2;
-                    fields = realloc(fields, sizeof(char *) * fields_cap);
-                    if (fields == NULL) {
-                        return NULL;
-                    }
+            if (c == delim) {
+                if (!s_view_push(view, view_cap, start, w, stats)) {
+                    return false;
                 }
+                *w++ = '\0';
+                start = w;
             } else if (c == '\"') {
                 /* Start quoted field only if at field start */
-                if (buf_len == 0) {
+                if (w == start) {
                     state = ST_QUOTED_FIELD;
+                    CSV_STAT(if (stats != NULL) { stats->quoted_fields++; });
                 } else {
                     /* Quote inside unquoted field: treat literally */
-                    if (buf_len + 1 >= buf_cap) {
-                        buf_cap *= 2;
-                        buf = realloc(buf, buf_cap);
-                        if (buf == NULL) {
-                            return NULL;
-                        }
-                    }
-                    buf[buf_len++] = (char) c;
+                    *w++ = c;
                 }
-            } else if (c == '\r' || c == '\n') {
-                /* End of line */
+            } else if (c == '\n') {
+                /* End of line (a bare carriage return is data, as for
+                 * the scanner) */
                 break;
             } else {
-                if (buf_len + 1 >= buf_cap) {
-                    buf_cap *= 2;
-                    buf = realloc(buf, buf_cap);
-                    if (buf == NULL) {
-                        return NULL;
-                    }
-                }
-                buf[buf_len++] = (char) c;
+                *w++ = c;
             }
         } else if (state == ST_QUOTED_FIELD) {
             if (c == '\"') {
                 state = ST_QUOTE_IN_QUOTED;
             } else {
-                if (buf_len + 1 >= buf_cap) {
-                    buf_cap *= 2;
-                    buf = realloc(buf, buf_cap);
-                    if (buf == NULL) {
-                        return NULL;
-                    }
-                }
-                buf[buf_len++] = (char) c;
+                *w++ = c;
             }
         } else if (state == ST_QUOTE_IN_QUOTED) {
             if (c == '\"') {
                 /* Escaped quote -> append one quote and return to
                  * quoted state */
-                if (buf_len + 1 >= buf_cap) {
-                    buf_cap *= 2;
-                    buf = realloc(buf, buf_cap);
-                    if (buf == NULL) {
-                        return NULL;
-                    }
-                }
-                buf[buf_len++] = '\"';
+                *w++ = '\"';
                 state = ST_QUOTED_FIELD;
-            } else if (c == (unsigned char) delim) {
+                CSV_STAT(if (stats != NULL) { stats->escaped_quotes++; });
+            } else if (c == delim) {
                 /* End quoted field */
-                buf[buf_len] = '\0';
-                fields[fields_cnt++] = strdup((char *) buf);
-                buf_len = 0;
-                if (fields_cnt == fields_cap) {
-                    fields_cap *= 2;
-                    fields = realloc(fields, sizeof(char *) * fields_cap);
-                    if (fields == NULL) {
-                        return NULL;
-                    }
+                if (!s_view_push(view, view_cap, start, w, stats)) {
+                    return false;
                 }
+                *w++ = '\0';
+                start = w;
                 state = ST_FIELD;
-            } else if (c == '\r' || c == '\n' || c == '\0') {
+            } else if (c == '\n') {
                 /* End of line after closing quote */
-                buf[buf_len] = '\0';
-                fields[fields_cnt++] = strdup((char *) buf);
-                buf_len = 0;
-                state = ST_FIELD;
                 break;
             } else {
                 /* NOTE.  Per permissive parsing: after quote, if not
@@ -251,16 +256,11 @@ static csv_row_td *s_parse_line_to_row(const char *line, char delim)
                  * To reprocess, do not advance 'p' here (use 'continue'
                  * with same pointer). */
                 /* End quoted field */
-                buf[buf_len] = '\0';
-                fields[fields_cnt++] = strdup((char *) buf);
-                buf_len = 0;
-                if (fields_cnt == fields_cap) {
-                    fields_cap *= 2;
-                    fields = realloc(fields, sizeof(char *) * fields_cap);
-                    if (fields == NULL) {
-                        return NULL;
-                    }
+                if (!s_view_push(view, view_cap, start, w, stats)) {
+                    return false;
                 }
+                *w++ = '\0';
+                start = w;
                 state = ST_FIELD;
                 continue;   /* Reprocess current char in 'ST_FIELD' */
             }
@@ -269,210 +269,1942 @@ static csv_row_td *s_parse_line_to_row(const char *line, char delim)
         p++;
     }
 
-    /* At line end: push last field (if any) */
-    if (state != ST_QUOTED_FIELD) {
-        buf[buf_len] = '\0';
-        fields[fields_cnt++] = strdup((char *) buf);
-    } else {
-        /* Unterminated quoted field: treat remainder as field (lenient) */
-        buf[buf_len] = '\0';
-        fields[fields_cnt++] = strdup((char *) buf);
+    /* At line end: push last field (if any); an unterminated quoted
+     * field is treated as the remainder of the line (lenient) */
+    if (!s_view_push(view, view_cap, start, w, stats)) {
+        return false;
     }
+    *w = '\0';
 
-    free(buf);
+    return true;
+}
 
-    /* Shrink to fit */
-    if (fields_cnt < fields_cap) {
-        fields = realloc(fields, sizeof(char *) * fields_cnt);
-        if (fields == NULL) {
-            return NULL;
+
+/**
+ * @brief Locate the fields of the current record as read
+ *
+ * Follows the grammar of @a s_split_line() over the bytes kept, without
+ * unescaping them, so every span covers a field exactly as it is in the
+ * file (quotes included).
+ *
+ * @param raw   Current record as read
+ * @param delim Field delimiter character
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_raw_split(csv_raw_td *raw, char delim)
+{
+    enum { ST_FIELD, ST_QUOTED_FIELD, ST_QUOTE_IN_QUOTED } state = ST_FIELD;
+    size_t start = 0;   /* Start of the current field */
+    size_t i = 0;
+
+    /* The carriage return of a CRLF terminator isn't in any field */
+    size_t len = raw->len;
+    if (len > 0 && raw->data[len - 1] == '\r') {
+        len--;
+    }
+    raw->num_fields = 0;
+    raw->open_quote = false;
+
+    for (;;) {
+        bool end = (i == len || raw->data[i] == '\0');
+        char c = (end) ? '\0' : raw->data[i];
+        bool push = end;
+        size_t next = i + 1;
+
+        if (!end && state == ST_FIELD) {
+            if (c == delim) {
+                push = true;
+            } else if (c == '\"' && i == start) {
+                state = ST_QUOTED_FIELD;
+            } else if (c == '\n') {
+                push = end = true;
+            }
+        } else if (!end && state == ST_QUOTED_FIELD) {
+            if (c == '\"') {
+                state = ST_QUOTE_IN_QUOTED;
+            }
+        } else if (!end && state == ST_QUOTE_IN_QUOTED) {
+            if (c == '\"') {
+                state = ST_QUOTED_FIELD;
+            } else if (c == '\n') {
+                push = end = true;
+            } else {
+                /* Closing quote, and the byte starts the next field */
+                push = true;
+                next = (c == delim) ? i + 1 : i;
+            }
+        }
+
+        if (push) {
+            if (raw->num_fields == raw->fields_cap) {
+                size_t cap = (raw->fields_cap) ? raw->fields_cap * 2 : 8;
+                csv_span_td *fields = realloc(raw->fields,
+                        sizeof(*fields) * cap);
+                if (fields == NULL) {
+                    return false;
+                }
+                raw->fields = fields;
+                raw->fields_cap = cap;
+            }
+            raw->fields[raw->num_fields].start = start;
+            raw->fields[raw->num_fields].end = i;
+            raw->num_fields++;
+            if (end) {
+                raw->open_quote = (state == ST_QUOTED_FIELD);
+                break;
+            }
+            start = next;
+            state = ST_FIELD;
         }
+        i = next;
     }
+    raw->split = true;
+
+    return true;
+}
+
 
+/**
+ * @brief Copy the fields of a row view into a newly allocated
+ *        @e csv_row_td structure
+ *
+ * @param view  Row view to copy the fields from
+ * @param stats Counters to update, or @c NULL
+ *
+ * @return Pointer to newly allocated @e csv_row_td, or @c NULL on
+ *         allocation failure
+ *
+ * @note The returned @e csv_row_td and its fields are heap-allocated
+ *       and must be freed with @a csv_parser_destroy_row().
+ */
+static csv_row_td *s_parse_line_to_row(const csv_row_view_td *view,
+        csv_stats_td *stats)
+{
     csv_row_td *csv_row = malloc(sizeof *csv_row);
     if (csv_row == NULL) {
         return NULL;
     }
-    csv_row->fields = fields;
-    csv_row->num_fields = fields_cnt;
+
+    csv_row->num_fields = 0;
+    csv_row->fields = malloc(sizeof(char *) * view->num_fields);
+    if (csv_row->fields == NULL) {
+        free(csv_row);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < view->num_fields; ++i) {
+        const csv_field_td *field = &view->fields[i];
+        char *s = malloc(field->len + 1);
+        if (s == NULL) {
+            csv_parser_destroy_row(csv_row);
+            return NULL;
+        }
+        memcpy(s, field->data, field->len + 1);
+        csv_row->fields[csv_row->num_fields++] = s;
+        CSV_STAT(if (stats != NULL) { stats->alloc_bytes += field->len + 1; });
+    }
+    CSV_STAT(if (stats != NULL) {
+                stats->allocs += 2 + view->num_fields;
+                stats->alloc_bytes += sizeof *csv_row +
+                    sizeof(char *) * view->num_fields;
+            });
 
     return csv_row;
 }
 
 
 /**
- * @brief Read the next non-skippable line from a file using @a getline()
+ * @brief Note the end of a record found by the scanner
  *
- * Repeatedly reads lines with @a getline() until a non-skippable line is
- * found (line_is_skippable returns false) or EOF/error occurs.  Removes
- * a trailing newline and optional carriage return from the buffer so
- * the returned line is null-terminated without CR/LF.
+ * @param scan   Scanner that found the record
+ * @param end    Position of the newline that ends the record
+ * @param spans  Where to store the record, or @c NULL
+ * @param n      Number of records found so far in this call
+ */
+static void s_scan_emit(csv_scan_td *scan, size_t end, csv_span_td *spans,
+        size_t n)
+{
+    if (spans != NULL) {
+        spans[n].start = scan->start;
+        spans[n].end = end;
+    }
+}
+
+
+/**
+ * @brief Find the first of either of two bytes, eight bytes at a time
  *
- * @param fp File pointer to read from (must be open for reading)
- * @param lineptr Pointer to a heap buffer pointer used by @a getline()
- * @param nptr    Pointer to size of @e *lineptr; may be 0
- * @param line_no Pointer to line counter to increment for each physical
- *                line read
+ * Words without any of both bytes are skipped whole: a byte of
+ * @c x = @c word ^ @c pattern is zero where they match, and
+ * @c (x - 0x01..01) & ~x & 0x80..80 is not zero iff some byte of @c x
+ * is zero.
  *
- * @return Number of characters in the returned line (excluding final
- *         @c NULL), or -1 on EOF or error (in that case @e *lineptr may
- *         be @c NULL or contain partial data)
+ * @param buf Buffer to search
+ * @param pos Position where to start searching
+ * @param end Position where to stop searching
+ * @param a   First byte to find
+ * @param b   Second byte to find
  *
- * @note On success, @e *lineptr is set (or reused) and contains the
- *       null-terminated line; caller owns and must free @e *lineptr.
- * @note The function increments @p line_no for every physical line read
- *       (including skipped ones).
+ * @return Position of the first @p a or @p b, or @p end if none
  */
-static ssize_t s_read_next_non_skippable_line(FILE *fp, char **lineptr,
-        size_t *nptr, size_t *line_no)
-{
-    ssize_t len;
-
-    while ((len = getline(lineptr, nptr, fp)) != -1) {
-        (*line_no)++;
-        /* Remove trailing newline for easier processing (keep null
-         * termination) */
-        if (len > 0 && ((*lineptr)[len - 1] == '\n')) {
-            (*lineptr)[len - 1] = '\0';
-            len--;
-            if (len > 0 && ((*lineptr)[len - 1] == '\r')) {
-                (*lineptr)[len - 1] = '\0';
-                len--;
-            }
+static inline size_t s_find_either(const char *buf, size_t pos, size_t end,
+        char a, char b)
+{
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t highs = UINT64_C(0x8080808080808080);
+    const uint64_t pattern_a = ones * (unsigned char) a;
+    const uint64_t pattern_b = ones * (unsigned char) b;
+
+    /* Most fields are short: look at the first bytes one by one */
+    for (size_t stop = (end - pos > 8) ? pos + 8 : end; pos < stop; ++pos) {
+        if (buf[pos] == a || buf[pos] == b) {
+            return pos;
         }
-        if (s_line_is_skippable(*lineptr)) {
-            continue;
+    }
+
+    while (end - pos >= sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, buf + pos, sizeof(uint64_t));
+
+        uint64_t xa = word ^ pattern_a;
+        uint64_t xb = word ^ pattern_b;
+        if (((xa - ones) & ~xa & highs) || ((xb - ones) & ~xb & highs)) {
+            break;
         }
-        return len;
+        pos += sizeof(uint64_t);
+    }
+
+    while (pos < end && buf[pos] != a && buf[pos] != b) {
+        pos++;
     }
-    return -1;
+
+    return pos;
 }
 
 
-/* Initialize the CSV parser */
-csv_parser_td *csv_parser_init(const char *filename, const char *delim,
-        bool has_header)
+/* Initialize a record scanner */
+void csv_scan_init(csv_scan_td *scan, char delim, csv_scan_state_td state,
+        size_t pos)
 {
-    csv_parser_td *csv_parser;
+    scan->state = state;
+    scan->delim = delim;
+    scan->pos = pos;
+    scan->start = pos;
+    scan->line_start = pos;
+    scan->lines = 0;
+    scan->skipped = 0;
+}
 
-    csv_parser = malloc(sizeof(csv_parser_td));
-    if (csv_parser == NULL) {
-        return NULL;
+
+/* Scan bytes looking for the ends of records */
+size_t csv_scan(csv_scan_td *scan, const char *buf, size_t end,
+        csv_span_td *spans, size_t max_spans)
+{
+    csv_scan_state_td state = scan->state;
+    const char delim = scan->delim;
+    size_t pos = scan->pos;
+    size_t n = 0;
+
+    while (pos < end && n < max_spans) {
+        char c = buf[pos];
+
+        switch (state) {
+            case CSV_SCAN_LINE_START:
+            case CSV_SCAN_BLANK:
+            case CSV_SCAN_BLANK_DELIM:
+                /* Blank lines and comments (after optional leading
+                 * whitespace) are skipped */
+                if (c == '\n') {
+                    scan->lines++;
+                    CSV_STAT(scan->skipped++);
+                    scan->start = scan->line_start = pos + 1;
+                    state = CSV_SCAN_LINE_START;
+                } else if (c == '#' || c == '\0') {
+                    state = CSV_SCAN_COMMENT;
+                } else if (isspace((unsigned char) c)) {
+                    state = (c == delim) ?
+                        CSV_SCAN_BLANK_DELIM : CSV_SCAN_BLANK;
+                } else {
+                    /* A record starts at the start of the line; the
+                     * whitespace seen, if any, belongs to its first
+                     * field unless it ended with a delimiter */
+                    state = (state == CSV_SCAN_BLANK) ?
+                        CSV_SCAN_UNQUOTED : CSV_SCAN_FIELD_START;
+                    continue;   /* Reprocess current char */
+                }
+                break;
+
+            case CSV_SCAN_COMMENT:
+                {
+                    const char *nl = memchr(buf + pos, '\n', end - pos);
+                    pos = (nl) ? (size_t) (nl - buf) : end;
+                }
+                if (pos == end) {
+                    continue;
+                }
+                scan->lines++;
+                CSV_STAT(scan->skipped++);
+                scan->start = scan->line_start = pos + 1;
+                state = CSV_SCAN_LINE_START;
+                break;
+
+            case CSV_SCAN_FIELD_START:
+                if (c == '\"') {
+                    state = CSV_SCAN_QUOTED;
+                } else if (c == '\n') {
+                    s_scan_emit(scan, pos, spans, n++);
+                    scan->lines++;
+                    scan->start = scan->line_start = pos + 1;
+                    state = CSV_SCAN_LINE_START;
+                } else if (c != delim) {
+                    state = CSV_SCAN_UNQUOTED;
+                }
+                break;
+
+            case CSV_SCAN_UNQUOTED:
+                /* Quotes inside unquoted fields are literal */
+                pos = s_find_either(buf, pos, end, delim, '\n');
+                if (pos == end) {
+                    continue;
+                }
+                if (buf[pos] == delim) {
+                    state = CSV_SCAN_FIELD_START;
+                } else {
+                    s_scan_emit(scan, pos, spans, n++);
+                    scan->lines++;
+                    scan->start = scan->line_start = pos + 1;
+                    state = CSV_SCAN_LINE_START;
+                }
+                break;
+
+            case CSV_SCAN_QUOTED:
+                /* Newlines inside quoted fields don't end the record */
+                pos = s_find_either(buf, pos, end, '\"', '\n');
+                while (pos < end && buf[pos] == '\n') {
+                    scan->lines++;
+                    scan->line_start = pos + 1;
+                    pos = s_find_either(buf, pos + 1, end, '\"', '\n');
+                }
+                if (pos == end) {
+                    continue;
+                }
+                state = CSV_SCAN_QUOTE_IN_QUOTED;
+                break;
+
+            case CSV_SCAN_QUOTE_IN_QUOTED:
+                if (c == '\"') {
+                    state = CSV_SCAN_QUOTED;
+                } else if (c == delim) {
+                    state = CSV_SCAN_FIELD_START;
+                } else if (c == '\n') {
+                    s_scan_emit(scan, pos, spans, n++);
+                    scan->lines++;
+                    scan->start = scan->line_start = pos + 1;
+                    state = CSV_SCAN_LINE_START;
+                } else {
+                    /* Permissive: the quoted field ended, and this
+                     * char starts an unquoted one */
+                    state = CSV_SCAN_UNQUOTED;
+                }
+                break;
+        }
+
+        pos++;
     }
 
-    csv_parser->fp = NULL;
-    csv_parser->filename = (filename) ? strdup(filename) : NULL;
-    csv_parser->line_no = 0;
-    csv_parser->has_header = has_header;
-    csv_parser->header = NULL;
-    csv_parser->delim =
-        (delim && *delim == ',') ? ',' : (delim &&
-                                         *delim &&
-                                         *delim != '\n' &&
-                                         *delim != '\r' &&
-                                         *delim != '"') ? *delim : ',';
+    scan->state = state;
+    scan->pos = pos;
 
-    return csv_parser;
+    return n;
 }
 
 
-/* Deallocate the memory used by the CSV parser */
-void csv_parser_destroy(csv_parser_td *csv_parser)
+/* Finish scanning at the end of the data */
+bool csv_scan_flush(csv_scan_td *scan, csv_span_td *span)
 {
-    if (csv_parser == NULL) {
-        return;
-    }
+    bool in_record = (scan->state == CSV_SCAN_FIELD_START ||
+            scan->state == CSV_SCAN_UNQUOTED ||
+            scan->state == CSV_SCAN_QUOTED ||
+            scan->state == CSV_SCAN_QUOTE_IN_QUOTED);
 
-    if (csv_parser->filename != NULL) {
-        free(csv_parser->filename);
+    /* An unterminated last line still counts as a line */
+    if (scan->pos > scan->line_start) {
+        scan->lines++;
+        CSV_STAT(if (!in_record) { scan->skipped++; });
     }
 
-    if (csv_parser->fp != NULL) {
-        fclose(csv_parser->fp);
+    if (in_record && span != NULL) {
+        /* Only a quoted field can leave a newline right before the end;
+         * it's the terminator of the last line, not field contents */
+        span->start = scan->start;
+        span->end = (scan->line_start == scan->pos && scan->pos > 0) ?
+            scan->pos - 1 : scan->pos;
     }
 
-    if (csv_parser->header != NULL) {
-        csv_parser_destroy_row(csv_parser->header);
-    }
+    scan->state = CSV_SCAN_LINE_START;
+    scan->start = scan->line_start = scan->pos;
 
-    free(csv_parser);
+    return in_record;
 }
 
 
-/* Deallocate the memory used by a row of the CSV parser */
-void csv_parser_destroy_row(csv_row_td *csv_row)
+/* Move a scanner back after discarding the start of its buffer */
+void csv_scan_shift(csv_scan_td *scan, size_t shift)
 {
-    if (csv_row == NULL) {
-        return;
-    }
+    scan->pos -= shift;
+    scan->start -= shift;
+    scan->line_start = (scan->line_start > shift) ?
+        scan->line_start - shift : 0;
+}
 
-    for (size_t i = 0; i < csv_row->num_fields; ++i) {
-        free(csv_row->fields[i]);
+
+/* Split a record into field slices, in place */
+bool csv_split_record(char *record, char delim, csv_row_view_td *view,
+        size_t *view_cap)
+{
+    if (record == NULL || view == NULL || view_cap == NULL) {
+        return false;
     }
 
-    free(csv_row->fields);
-    free(csv_row);
+    return s_split_line(record, delim, view, view_cap, NULL);
 }
 
 
-/* Get the header of the CSV file, if any */
-const csv_row_td *csv_parser_header(csv_parser_td *csv_parser)
+/* Copy a row view into a newly allocated row */
+csv_row_td *csv_row_from_view(const csv_row_view_td *view)
 {
-    if (csv_parser == NULL || !csv_parser->has_header) {
+    if (view == NULL) {
         return NULL;
     }
 
-    if (csv_parser->header) {
-        return csv_parser->header;
+    return s_parse_line_to_row(view, NULL);
+}
+
+
+/**
+ * @brief Hash a header name (64-bit FNV-1a)
+ *
+ * @param name Null-terminated name to hash
+ *
+ * @return Hash of @p name
+ */
+static uint64_t s_hash_name(const char *name)
+{
+    uint64_t h = UINT64_C(0xcbf29ce484222325);
+
+    while (*name) {
+        h ^= (unsigned char) *name++;
+        h *= UINT64_C(0x100000001b3);
     }
 
-    char *line = NULL;
-    size_t cap = 0;
-    ssize_t len = s_read_next_non_skippable_line(csv_parser->fp, &line,
-            &cap, &csv_parser->line_no);
-    if (len == -1) {
-        free(line);
-        return NULL;
+    return h;
+}
+
+
+/**
+ * @brief Get the slot of a name hash for a given bucket displacement
+ *
+ * @param h    Hash of the name
+ * @param disp Displacement of the bucket of the name
+ * @param mask Number of slots minus one
+ *
+ * @return Slot of the name
+ */
+static size_t s_hash_slot(uint64_t h, size_t disp, size_t mask)
+{
+    /* SplitMix64 finalizer, so that every displacement gives an
+     * unrelated permutation of the slots */
+    h += (uint64_t) (disp + 1) * UINT64_C(0x9e3779b97f4a7c15);
+    h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+    h ^= h >> 31;
+
+    return (size_t) h & mask;
+}
+
+
+/**
+ * @brief Deallocate the memory used by a header index
+ *
+ * @param index Header index to free
+ */
+static void s_header_index_destroy(csv_header_index_td *index)
+{
+    if (index == NULL) {
+        return;
     }
 
-    csv_parser->header = s_parse_line_to_row(line, csv_parser->delim);
-    free(line);
+    free(index->slots);
+    free(index->disp);
+    free(index);
+}
 
-    return csv_parser->header;
+
+/**
+ * @brief Try to place every name of the header in a table of slots
+ *
+ * Buckets are placed from the largest to the smallest; for each one,
+ * displacements are tried until all its names fall in free slots.
+ *
+ * @param index   Header index, with its slots and buckets allocated
+ * @param hashes  Hash of every name
+ * @param members Names (column indices) grouped by bucket, where
+ *                duplicated names are @c CSV_NO_COLUMN
+ * @param start   Where every bucket starts in @p members (one more
+ *                entry than buckets)
+ * @param max     Size of the largest bucket
+ *
+ * @return @c true on success, @c false if some bucket can't be placed
+ */
+static bool s_header_index_place(csv_header_index_td *index,
+        const uint64_t *hashes, const size_t *members, const size_t *start,
+        size_t max)
+{
+    const size_t max_disp = 4 * index->num_slots + 64;
+    size_t mask = index->num_slots - 1;
+
+    for (size_t i = 0; i < index->num_slots; ++i) {
+        index->slots[i] = CSV_NO_COLUMN;
+    }
+
+    for (size_t size = max; size > 0; --size) {
+        for (size_t b = 0; b < index->num_buckets; ++b) {
+            size_t live = 0;
+            for (size_t k = start[b]; k < start[b + 1]; ++k) {
+                live += (members[k] != CSV_NO_COLUMN);
+            }
+            if (live != size) {
+                continue;
+            }
+
+            size_t disp, k = start[b];
+            for (disp = 0; disp < max_disp; ++disp) {
+                for (k = start[b]; k < start[b + 1]; ++k) {
+                    size_t col = members[k];
+                    if (col == CSV_NO_COLUMN) {
+                        continue;
+                    }
+                    size_t slot = s_hash_slot(hashes[col], disp, mask);
+                    if (index->slots[slot] != CSV_NO_COLUMN) {
+                        break;
+                    }
+                    index->slots[slot] = col;
+                }
+                if (k == start[b + 1]) {
+                    break;
+                }
+                /* Collision: undo the slots taken by this attempt */
+                for (size_t j = start[b]; j < k; ++j) {
+                    if (members[j] != CSV_NO_COLUMN) {
+                        index->slots[s_hash_slot(hashes[members[j]], disp,
+                                mask)] = CSV_NO_COLUMN;
+                    }
+                }
+            }
+            if (disp == max_disp) {
+                return false;
+            }
+            index->disp[b] = disp;
+        }
+    }
+
+    return true;
 }
 
 
-/* Get the current row that it's being parsed */
-csv_row_td *csv_parser_row(csv_parser_td *csv_parser)
+/**
+ * @brief Build the perfect hash of the names of a header
+ *
+ * @param header Header whose names have to be indexed
+ *
+ * @return Pointer to the new header index, or @c NULL otherwise
+ */
+static csv_header_index_td *s_header_index_build(const csv_row_td *header)
 {
-    if (csv_parser == NULL) {
+    size_t n = header->num_fields;
+    size_t max = 0;
+    bool placed = false;
+
+    csv_header_index_td *index = malloc(sizeof(csv_header_index_td));
+    uint64_t *hashes = malloc(sizeof(uint64_t) * n);
+    size_t *members = malloc(sizeof(size_t) * n);
+    size_t *start = calloc(n + 2, sizeof(size_t));
+    if (index == NULL || hashes == NULL || members == NULL ||
+            start == NULL) {
+        free(index);
+        free(hashes);
+        free(members);
+        free(start);
         return NULL;
     }
 
-    if (csv_parser->fp == NULL) {
-        csv_parser->fp = fopen(csv_parser->filename, "rb");
-        if (csv_parser->fp == NULL) {
-            return NULL;
+    index->num_buckets = n;
+    index->num_slots = 2;
+    while (index->num_slots < 2 * n) {
+        index->num_slots *= 2;
+    }
+    index->disp = calloc(n, sizeof(size_t));
+    index->slots = NULL;
+
+    /* Group the names by bucket (counting sort, stable) */
+    for (size_t i = 0; i < n; ++i) {
+        hashes[i] = s_hash_name(header->fields[i]);
+        start[hashes[i] % n + 2]++;
+    }
+    for (size_t b = 0; b < n; ++b) {
+        start[b + 2] += start[b + 1];
+    }
+    for (size_t i = 0; i < n; ++i) {
+        members[start[hashes[i] % n + 1]++] = i;
+    }
+
+    /* Duplicated names can't be told apart: keep the first one only */
+    for (size_t b = 0; b < n; ++b) {
+        size_t size = 0;
+        for (size_t k = start[b]; k < start[b + 1]; ++k) {
+            for (size_t j = start[b]; j < k; ++j) {
+                if (members[j] != CSV_NO_COLUMN &&
+                        hashes[members[j]] == hashes[members[k]] &&
+                        strcmp(header->fields[members[j]],
+                            header->fields[members[k]]) == 0) {
+                    members[k] = CSV_NO_COLUMN;
+                    break;
+                }
+            }
+            size += (members[k] != CSV_NO_COLUMN);
         }
+        max = (size > max) ? size : max;
     }
 
-    /* If header requested but not yet consumed, consume it first */
-    if (csv_parser->has_header && csv_parser->header == NULL) {
-        (void) csv_parser_header(csv_parser);
-        /* header consumed; continue to next row */
+    /* Rarely, a table is too crowded; retry with a larger one */
+    for (int attempt = 0; attempt < 4 && index->disp != NULL; ++attempt) {
+        free(index->slots);
+        index->slots = malloc(sizeof(size_t) * index->num_slots);
+        if (index->slots == NULL) {
+            break;
+        }
+        placed = s_header_index_place(index, hashes, members, start, max);
+        if (placed) {
+            break;
+        }
+        index->num_slots *= 2;
     }
 
-    char *line = NULL;
-    size_t cap = 0;
-    ssize_t len = s_read_next_non_skippable_line(csv_parser->fp, &line,
-            &cap, &csv_parser->line_no);
-    if (len == -1) {
-        free(line);
+    free(hashes);
+    free(members);
+    free(start);
+
+    if (!placed) {
+        s_header_index_destroy(index);
         return NULL;
     }
 
-    csv_row_td *csv_row = s_parse_line_to_row(line, csv_parser->delim);
-	free(line);
+    return index;
+}
+
 
-    return csv_row;
+/**
+ * @brief Open the CSV file of the parser, if not opened yet
+ *
+ * @param csv_parser CSV parser whose file has to be opened
+ *
+ * @return @c true if the file is open, @c false otherwise
+ */
+static bool s_open(csv_parser_td *csv_parser)
+{
+    if (csv_parser->fp == NULL) {
+        if (csv_parser->filename == NULL) {
+            return false;
+        }
+        csv_parser->fp = fopen(csv_parser->filename, "rb");
+        CSV_TRACE2(open, csv_parser->filename, csv_parser->fp != NULL);
+    }
+
+    return (csv_parser->fp != NULL);
+}
+
+
+/**
+ * @brief Add the time since the last mark to a counter, and mark again
+ *
+ * @param csv_parser CSV parser being timed
+ * @param counter    Counter where to add the time, in nanoseconds, or
+ *                   @c NULL to only mark
+ */
+static void s_stat_lap(csv_parser_td *csv_parser, uint64_t *counter)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    uint64_t now = (uint64_t) ts.tv_sec * UINT64_C(1000000000) +
+        (uint64_t) ts.tv_nsec;
+    if (counter != NULL) {
+        *counter += now - csv_parser->stats_mark;
+    }
+    csv_parser->stats_mark = now;
+}
+
+
+/**
+ * @brief Refill the read buffer of the parser
+ *
+ * Discards the bytes before the record (or line) being scanned, moving
+ * the rest to the start of the buffer, grows the buffer if it's still
+ * full, and appends as many bytes from the file as fit.
+ *
+ * @param csv_parser CSV parser whose buffer has to be refilled
+ *
+ * @return @c true if bytes were added, @c false on EOF or error
+ */
+static bool s_refill(csv_parser_td *csv_parser)
+{
+    csv_scan_td *scan = &csv_parser->scan;
+    size_t shift = scan->start;
+
+    if (shift > 0) {
+        memmove(csv_parser->buf, csv_parser->buf + shift,
+                csv_parser->buf_len - shift);
+        csv_parser->buf_len -= shift;
+        csv_parser->buf_offset += (off_t) shift;
+        csv_scan_shift(scan, shift);
+    }
+
+    /* One byte is always kept spare to null-terminate the last record */
+    if (csv_parser->buf_len + 1 >= csv_parser->buf_cap) {
+        size_t cap = (csv_parser->buf_cap) ?
+            csv_parser->buf_cap * 2 : CSV_READ_BUF;
+        char *buf = realloc(csv_parser->buf, cap);
+        if (buf == NULL) {
+            return false;
+        }
+        CSV_TRACE2(buffer__grow, csv_parser->buf_cap, cap);
+        csv_parser->buf = buf;
+        csv_parser->buf_cap = cap;
+        CSV_STAT(csv_parser->stats.allocs++;
+                csv_parser->stats.alloc_bytes += cap;
+                csv_parser->stats.buf_grows++);
+    }
+
+    CSV_STAT(s_stat_lap(csv_parser, NULL));
+    CSV_TRACE1(refill__start, csv_parser->buf_offset +
+            (off_t) csv_parser->buf_len);
+    size_t n = fread(csv_parser->buf + csv_parser->buf_len, 1,
+            csv_parser->buf_cap - csv_parser->buf_len - 1, csv_parser->fp);
+    CSV_TRACE1(refill__done, n);
+    csv_parser->buf_len += n;
+    CSV_STAT(s_stat_lap(csv_parser, &csv_parser->stats.io_ns);
+            csv_parser->stats.bytes_read += n);
+
+    return (n > 0);
+}
+
+
+/**
+ * @brief Wait until the file is appended to, or the time runs out
+ *
+ * Uses inotify where available and sleeps otherwise.
+ *
+ * @param csv_parser CSV parser following the file
+ * @param timeout_ms Maximum time to wait, in milliseconds, or @c -1 to
+ *                   wait forever
+ *
+ * @return @c true if the file may have grown, @c false on timeout, or
+ *         if the file was removed or renamed
+ */
+static bool s_wait_append(csv_parser_td *csv_parser, int timeout_ms)
+{
+#if defined(__linux__)
+    if (csv_parser->follow_fd != -1) {
+        struct pollfd pfd = { csv_parser->follow_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            return false;
+        }
+
+        /* Drain the events; any of them means it's worth reading */
+        char events[4096];
+        ssize_t len;
+        while ((len = read(csv_parser->follow_fd, events,
+                        sizeof(events))) > 0) {
+            for (ssize_t i = 0; i < len; ) {
+                struct inotify_event event;
+                memcpy(&event, events + i, sizeof(event));
+                if (event.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    return false;
+                }
+                i += (ssize_t) (sizeof(event) + event.len);
+            }
+        }
+    } else
+#endif
+    {
+        if (timeout_ms == 0) {
+            return false;
+        }
+        int ms = (timeout_ms < 0 || timeout_ms > CSV_FOLLOW_POLL) ?
+            CSV_FOLLOW_POLL : timeout_ms;
+        struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+        nanosleep(&ts, NULL);
+    }
+
+    /* Forget the EOF, so that the stream reads again */
+    clearerr(csv_parser->fp);
+
+    return true;
+}
+
+
+/**
+ * @brief Hash the last record read, if it wasn't yet
+ *
+ * Only @a csv_parser_refresh() needs the hash, so it's taken once EOF is
+ * reached (or by the refresh itself) rather than for every record.  The
+ * bytes are read again from the file, as splitting rewrites them in the
+ * buffer.
+ *
+ * @param csv_parser CSV parser whose last record to hash
+ */
+static void s_hash_last(csv_parser_td *csv_parser)
+{
+    if (csv_parser->record_hashed || csv_parser->record_hash_end < 0 ||
+            csv_parser->fp == NULL) {
+        return;
+    }
+
+    size_t len = (size_t) (csv_parser->record_hash_end -
+            csv_parser->record_offset);
+    char *bytes = malloc(len + 1);
+    if (bytes != NULL && pread(fileno(csv_parser->fp), bytes, len,
+                csv_parser->record_offset) == (ssize_t) len) {
+        csv_parser->record_hash = csv_hash_bytes(bytes, len);
+        csv_parser->record_hashed = true;
+    }
+    free(bytes);
+}
+
+
+/**
+ * @brief Refill the read buffer, waiting for appended data if following
+ *
+ * @param csv_parser CSV parser whose buffer has to be refilled
+ *
+ * @return @c true if bytes were added, @c false on EOF (or when the time
+ *         to wait for more runs out), or on error
+ */
+static bool s_refill_or_wait(csv_parser_td *csv_parser)
+{
+    struct timespec start, now;
+    int timeout_ms = csv_parser->follow_timeout;
+
+    if (s_refill(csv_parser)) {
+        return true;
+    }
+    s_hash_last(csv_parser);
+    if (!csv_parser->follow || ferror(csv_parser->fp)) {
+        return false;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (;;) {
+        int left = timeout_ms;
+        if (timeout_ms > 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long elapsed = (long) (now.tv_sec - start.tv_sec) * 1000 +
+                (now.tv_nsec - start.tv_nsec) / 1000000;
+            left = (elapsed >= timeout_ms) ? 0 :
+                timeout_ms - (int) elapsed;
+        }
+        if (!s_wait_append(csv_parser, left)) {
+            return false;
+        }
+        if (s_refill(csv_parser)) {
+            return true;
+        }
+    }
+}
+
+
+/**
+ * @brief Read the next record from the file, skipping blank and
+ *        comment lines
+ *
+ * Records end at the first newline that is not inside a quoted field,
+ * so quoted fields may span several physical lines.
+ *
+ * @param csv_parser CSV parser where to read the record from
+ * @param span       Where to store the position of the record in the
+ *                   read buffer (without the newline)
+ *
+ * @return @c true on success, @c false on EOF or error
+ *
+ * @note Updates the line number with every physical line read
+ *       (including skipped ones).
+ */
+static bool s_read_next_record(csv_parser_td *csv_parser, csv_span_td *span)
+{
+    csv_scan_td *scan = &csv_parser->scan;
+
+    CSV_STAT(s_stat_lap(csv_parser, NULL));
+    while (csv_scan(scan, csv_parser->buf, csv_parser->buf_len, span, 1)
+            == 0) {
+        CSV_STAT(s_stat_lap(csv_parser, &csv_parser->stats.parse_ns));
+        if (!s_refill_or_wait(csv_parser)) {
+            /* The last record may lack its newline, unless more is
+             * still to be appended */
+            bool found = !csv_parser->follow && csv_scan_flush(scan, span);
+            csv_parser->line_no = scan->lines;
+            return found;
+        }
+        CSV_STAT(s_stat_lap(csv_parser, NULL));
+    }
+
+    csv_parser->line_no = scan->lines;
+
+    return true;
+}
+
+
+/**
+ * @brief Skip records without locating each of them in the buffer
+ *
+ * The scanner runs over whole buffers at a time, only counting record
+ * terminators.
+ *
+ * @param csv_parser CSV parser where to skip the records
+ * @param n          Number of records to skip
+ *
+ * @return Number of records skipped (less than @p n only at EOF or on
+ *         error)
+ */
+static size_t s_skip_records(csv_parser_td *csv_parser, size_t n)
+{
+    csv_scan_td *scan = &csv_parser->scan;
+    size_t skipped = 0;
+
+    csv_parser->record_hashed = false;
+    csv_parser->record_hash_end = -1;
+    csv_parser->record_end = -1;
+    csv_parser->raw.valid = false;
+    if (csv_parser->cache_active) {
+        const csv_cache_td *cache = csv_parser->cache;
+        size_t left = cache->num_records - csv_parser->cache_pos;
+        skipped = (n < left) ? n : left;
+        csv_parser->cache_pos += skipped;
+        /* Short of records, the lines after the last one count too */
+        if (skipped < n) {
+            csv_parser->line_no = (size_t)
+                cache->records[cache->num_records].lines;
+        } else if (csv_parser->cache_pos > 0) {
+            csv_parser->line_no = (size_t)
+                cache->records[csv_parser->cache_pos - 1].lines;
+        }
+        CSV_STAT(csv_parser->stats.records += skipped);
+        return skipped;
+    }
+    while (skipped < n) {
+        CSV_STAT(s_stat_lap(csv_parser, NULL));
+        skipped += csv_scan(scan, csv_parser->buf, csv_parser->buf_len,
+                NULL, n - skipped);
+        CSV_STAT(s_stat_lap(csv_parser, &csv_parser->stats.parse_ns));
+        if (skipped < n && !s_refill_or_wait(csv_parser)) {
+            skipped += (!csv_parser->follow &&
+                    csv_scan_flush(scan, NULL)) ? 1 : 0;
+            break;
+        }
+    }
+    csv_parser->line_no = scan->lines;
+    CSV_STAT(csv_parser->stats.records += skipped);
+
+    return skipped;
+}
+
+
+/**
+ * @brief Move the parser to a position right after a record
+ *
+ * @param csv_parser CSV parser to move
+ * @param offset     File offset right after a record (or @c 0)
+ * @param lines      Number of lines before @p offset
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_reposition(csv_parser_td *csv_parser, off_t offset,
+        size_t lines)
+{
+    if (!s_open(csv_parser) ||
+            fseeko(csv_parser->fp, offset, SEEK_SET) != 0) {
+        return false;
+    }
+
+    csv_parser->cache_active = false;
+    csv_parser->buf_len = 0;
+    csv_parser->buf_offset = offset;
+    csv_parser->record_hashed = false;
+    csv_parser->record_hash_end = -1;
+    csv_parser->record_end = -1;
+    csv_parser->raw.valid = false;
+    CSV_STAT(csv_parser->stats.skipped_lines += csv_parser->scan.skipped);
+    csv_scan_init(&csv_parser->scan, csv_parser->delim, CSV_SCAN_LINE_START,
+            0);
+    csv_parser->scan.lines = lines;
+    csv_parser->line_no = lines;
+
+    return true;
+}
+
+
+/**
+ * @brief Tell whether a record follows, without reading it
+ *
+ * The scanner is run on a copy over what's left of the buffer; if the
+ * record may go on past it, the record is skipped and the parser is
+ * moved back.
+ *
+ * @param csv_parser CSV parser right after a record (or at the start)
+ *
+ * @return @c true if a record follows, @c false at EOF or on error
+ */
+static bool s_record_follows(csv_parser_td *csv_parser)
+{
+    csv_scan_td peek = csv_parser->scan;
+
+    if (csv_scan(&peek, csv_parser->buf, csv_parser->buf_len, NULL, 1)) {
+        return true;
+    }
+
+    off_t offset = csv_parser->buf_offset + (off_t) csv_parser->scan.pos;
+    size_t lines = csv_parser->scan.lines;
+
+    return s_skip_records(csv_parser, 1) == 1 &&
+        s_reposition(csv_parser, offset, lines);
+}
+
+
+/**
+ * @brief Read the next record from the parse cache
+ *
+ * @param csv_parser CSV parser reading through its cache
+ *
+ * @return Pointer to the parser's row view, or @c NULL at the end of
+ *         the cache or on error
+ */
+static const csv_row_view_td *s_cache_view(csv_parser_td *csv_parser)
+{
+    const csv_cache_td *cache = csv_parser->cache;
+    csv_row_view_td *view = &csv_parser->view;
+
+    if (csv_parser->cache_pos == cache->num_records) {
+        csv_parser->line_no =
+            (size_t) cache->records[cache->num_records].lines;
+        return NULL;
+    }
+
+    const csv_cache_record_td *record =
+        &cache->records[csv_parser->cache_pos++];
+    view->num_fields = 0;
+    for (uint64_t i = record->field; i < record[1].field; ++i) {
+        /* Every value is followed by its null byte */
+        if (!s_view_push(view, &csv_parser->view_cap,
+                    cache->values + cache->fields[i],
+                    cache->values + cache->fields[i + 1] - 1,
+                    &csv_parser->stats)) {
+            return NULL;
+        }
+    }
+
+    csv_parser->record_offset = (off_t) record->offset;
+    csv_parser->record_end = (off_t) record->end;
+    csv_parser->record_newline = (record->end < cache->size ||
+            cache->last_newline);
+    csv_parser->line_no = (size_t) record->lines;
+    CSV_STAT(csv_parser->stats.records++);
+
+    return view;
+}
+
+
+/**
+ * @brief Go on reading from the file, right after the last record read
+ *        from the parse cache
+ *
+ * @param csv_parser CSV parser reading through its cache, or not
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_cache_leave(csv_parser_td *csv_parser)
+{
+    if (!csv_parser->cache_active) {
+        return true;
+    }
+
+    size_t pos = csv_parser->cache_pos;
+    const csv_cache_record_td *last = (pos > 0) ?
+        &csv_parser->cache->records[pos - 1] : NULL;
+
+    return s_reposition(csv_parser, (last) ? (off_t) last->end : 0,
+            (last) ? (size_t) last->lines : 0);
+}
+
+
+/**
+ * @brief Keep a copy of the current record as read
+ *
+ * @param csv_parser CSV parser that read the record
+ * @param record     First byte of the record
+ * @param len        Number of bytes of the record
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_raw_keep(csv_parser_td *csv_parser, const char *record,
+        size_t len)
+{
+    csv_raw_td *raw = &csv_parser->raw;
+
+    if (len > raw->cap) {
+        size_t cap = (raw->cap) ? raw->cap : 256;
+        while (cap < len) {
+            cap *= 2;
+        }
+        char *data = realloc(raw->data, cap);
+        if (data == NULL) {
+            return false;
+        }
+        CSV_STAT(csv_parser->stats.allocs++;
+                csv_parser->stats.alloc_bytes += cap);
+        raw->data = data;
+        raw->cap = cap;
+    }
+    memcpy(raw->data, record, len);
+    raw->len = len;
+    raw->split = false;
+    raw->valid = true;
+
+    return true;
+}
+
+
+/**
+ * @brief Read and split the next non-skippable record of the CSV file
+ *
+ * @param csv_parser CSV parser where to read the record from
+ *
+ * @return Pointer to the parser's row view, or @c NULL on EOF or error
+ *
+ * @note The view is overwritten by the next call.
+ */
+static const csv_row_view_td *s_next_view(csv_parser_td *csv_parser)
+{
+    csv_span_td span;
+
+    CSV_TRACE0(record__start);
+    csv_parser->record_end = -1;
+    csv_parser->raw.valid = false;
+    if (csv_parser->cache_active) {
+        csv_parser->record_hashed = false;
+        csv_parser->record_hash_end = -1;
+        return s_cache_view(csv_parser);
+    }
+    if (!s_open(csv_parser) || !s_read_next_record(csv_parser, &span)) {
+        return NULL;
+    }
+    CSV_STAT(csv_parser->stats.records++);
+    csv_parser->record_offset = csv_parser->buf_offset + (off_t) span.start;
+    csv_parser->record_hashed = false;
+    csv_parser->record_hash_end = csv_parser->buf_offset +
+        (off_t) csv_parser->scan.pos;
+    csv_parser->record_end = csv_parser->buf_offset +
+        (off_t) csv_parser->scan.pos;
+    csv_parser->record_newline = (csv_parser->scan.pos > span.end &&
+            csv_parser->buf[csv_parser->scan.pos - 1] == '\n');
+
+    /* Remove the trailing carriage return (keep null termination); as
+     * read, the record keeps it, or a bare one before it would end up
+     * as the terminator's */
+    char *record = csv_parser->buf + span.start;
+    size_t len = span.end - span.start;
+    if (csv_parser->raw.keep && !s_raw_keep(csv_parser, record, len)) {
+        return NULL;
+    }
+    if (len > 0 && record[len - 1] == '\r') {
+        len--;
+    }
+    record[len] = '\0';
+
+    if (!s_split_line(record, csv_parser->delim, &csv_parser->view,
+                &csv_parser->view_cap, &csv_parser->stats)) {
+        return NULL;
+    }
+    CSV_TRACE3(record__done, csv_parser->record_offset, len,
+            csv_parser->view.num_fields);
+    CSV_STAT(s_stat_lap(csv_parser, &csv_parser->stats.parse_ns));
+
+    return &csv_parser->view;
+}
+
+
+/* Get the delimiter character a parser uses for a given string */
+char csv_parser_delim(const char *delim)
+{
+    return (delim && *delim == ',') ? ',' : (delim &&
+                                            *delim &&
+                                            *delim != '\n' &&
+                                            *delim != '\r' &&
+                                            *delim != '"') ? *delim : ',';
+}
+
+
+/* Initialize the CSV parser */
+csv_parser_td *csv_parser_init(const char *filename, const char *delim,
+        bool has_header)
+{
+    csv_parser_td *csv_parser;
+
+    csv_parser = malloc(sizeof(csv_parser_td));
+    if (csv_parser == NULL) {
+        return NULL;
+    }
+
+    csv_parser->fp = NULL;
+    csv_parser->filename = (filename) ? strdup(filename) : NULL;
+    csv_parser->line_no = 0;
+    csv_parser->has_header = has_header;
+    csv_parser->header = NULL;
+    csv_parser->header_index = NULL;
+    csv_parser->delim = csv_parser_delim(delim);
+    csv_parser->buf = NULL;
+    csv_parser->buf_cap = 0;
+    csv_parser->buf_len = 0;
+    csv_parser->buf_offset = 0;
+    csv_scan_init(&csv_parser->scan, csv_parser->delim, CSV_SCAN_LINE_START,
+            0);
+    csv_parser->view.fields = NULL;
+    csv_parser->view.num_fields = 0;
+    csv_parser->view_cap = 0;
+    csv_parser->row_index = NULL;
+    csv_parser->row_index_loaded = false;
+    csv_parser->cache = NULL;
+    csv_parser->cache_pos = 0;
+    csv_parser->cache_active = false;
+    csv_parser->record_offset = 0;
+    csv_parser->record_hash = 0;
+    csv_parser->record_hashed = false;
+    csv_parser->record_hash_end = -1;
+    csv_parser->record_end = -1;
+    csv_parser->record_newline = false;
+    csv_parser->follow = false;
+    csv_parser->follow_timeout = -1;
+    csv_parser->follow_fd = -1;
+    memset(&csv_parser->stats, 0, sizeof(csv_parser->stats));
+    csv_parser->stats_mark = 0;
+    csv_parser->latency = NULL;
+    memset(&csv_parser->raw, 0, sizeof(csv_parser->raw));
+    CSV_STAT(csv_parser->stats.allocs = (filename) ? 2 : 1;
+            csv_parser->stats.alloc_bytes = sizeof(csv_parser_td) +
+                ((filename) ? strlen(filename) + 1 : 0));
+
+    return csv_parser;
+}
+
+
+/* Deallocate the memory used by the CSV parser */
+void csv_parser_destroy(csv_parser_td *csv_parser)
+{
+    if (csv_parser == NULL) {
+        return;
+    }
+
+    if (csv_parser->filename != NULL) {
+        free(csv_parser->filename);
+    }
+
+    if (csv_parser->fp != NULL) {
+        fclose(csv_parser->fp);
+    }
+
+    if (csv_parser->header != NULL) {
+        csv_parser_destroy_row(csv_parser->header);
+    }
+
+    s_header_index_destroy(csv_parser->header_index);
+    csv_index_destroy(csv_parser->row_index);
+    csv_cache_destroy(csv_parser->cache);
+    if (csv_parser->follow_fd != -1) {
+        close(csv_parser->follow_fd);
+    }
+    free(csv_parser->latency);
+    free(csv_parser->raw.data);
+    free(csv_parser->raw.fields);
+    free(csv_parser->buf);
+    free(csv_parser->view.fields);
+    free(csv_parser);
+}
+
+
+/* Deallocate the memory used by a row of the CSV parser */
+void csv_parser_destroy_row(csv_row_td *csv_row)
+{
+    if (csv_row == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < csv_row->num_fields; ++i) {
+        free(csv_row->fields[i]);
+    }
+
+    free(csv_row->fields);
+    free(csv_row);
+}
+
+
+/**
+ * @brief Set the header of the parser, replacing the current one
+ *
+ * @param csv_parser CSV parser where to set the header
+ * @param header     Header to set (owned by the parser from now on)
+ */
+static void s_set_header(csv_parser_td *csv_parser, csv_row_td *header)
+{
+    csv_parser_destroy_row(csv_parser->header);
+    s_header_index_destroy(csv_parser->header_index);
+    csv_parser->header_index = NULL;
+
+    csv_parser->header = header;
+    if (header != NULL && header->num_fields > 0) {
+        /* On failure, names are looked up linearly instead */
+        csv_parser->header_index = s_header_index_build(header);
+    }
+}
+
+
+/* Get the header of the CSV file, if any */
+const csv_row_td *csv_parser_header(csv_parser_td *csv_parser)
+{
+    if (csv_parser == NULL || !csv_parser->has_header) {
+        return NULL;
+    }
+
+    if (csv_parser->header) {
+        return csv_parser->header;
+    }
+
+    CSV_TRACE0(header__start);
+    const csv_row_view_td *view = s_next_view(csv_parser);
+    if (view == NULL) {
+        return NULL;
+    }
+
+    s_set_header(csv_parser, s_parse_line_to_row(view, &csv_parser->stats));
+    CSV_TRACE1(header__done,
+            (csv_parser->header) ? csv_parser->header->num_fields : 0);
+
+    return csv_parser->header;
+}
+
+
+/* Get the index of a column from its name in the header */
+size_t csv_parser_column_index(csv_parser_td *csv_parser, const char *name)
+{
+    if (name == NULL) {
+        return CSV_NO_COLUMN;
+    }
+
+    const csv_row_td *header = csv_parser_header(csv_parser);
+    if (header == NULL) {
+        return CSV_NO_COLUMN;
+    }
+
+    const csv_header_index_td *index = csv_parser->header_index;
+    if (index == NULL) {
+        for (size_t i = 0; i < header->num_fields; ++i) {
+            if (strcmp(header->fields[i], name) == 0) {
+                return i;
+            }
+        }
+        return CSV_NO_COLUMN;
+    }
+
+    uint64_t h = s_hash_name(name);
+    size_t disp = index->disp[h % index->num_buckets];
+    size_t col = index->slots[s_hash_slot(h, disp, index->num_slots - 1)];
+    if (col != CSV_NO_COLUMN && strcmp(header->fields[col], name) == 0) {
+        return col;
+    }
+
+    return CSV_NO_COLUMN;
+}
+
+
+/* Get a field of a row */
+const char *csv_row_get(const csv_row_td *csv_row, size_t index)
+{
+    if (csv_row == NULL || index >= csv_row->num_fields) {
+        return NULL;
+    }
+
+    return csv_row->fields[index];
+}
+
+
+/* Get a field of a row view */
+const csv_field_td *csv_row_view_get(const csv_row_view_td *view,
+        size_t index)
+{
+    if (view == NULL || index >= view->num_fields) {
+        return NULL;
+    }
+
+    return &view->fields[index];
+}
+
+
+/**
+ * @brief Get the fields of the next row, consuming the header first if
+ *        needed
+ *
+ * @param csv_parser CSV parser where to read the row from
+ *
+ * @return Pointer to the parser's row view, or @c NULL on EOF or error
+ */
+static const csv_row_view_td *s_row_view(csv_parser_td *csv_parser)
+{
+    /* If header requested but not yet consumed, consume it first */
+    if (csv_parser->has_header && csv_parser->header == NULL) {
+        if (csv_parser_header(csv_parser) == NULL) {
+            return NULL;
+        }
+        /* header consumed; continue to next row */
+    }
+
+    return s_next_view(csv_parser);
+}
+
+
+/**
+ * @brief Get the time of a monotonic clock, for latencies
+ *
+ * @return Time, in nanoseconds
+ */
+static uint64_t s_latency_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * UINT64_C(1000000000) +
+        (uint64_t) ts.tv_nsec;
+}
+
+
+/**
+ * @brief Record the latency of a row call
+ *
+ * @param csv_parser CSV parser whose call was timed
+ * @param start      Time when the call started, in nanoseconds
+ * @param found      Whether the call returned a record
+ */
+static void s_latency_record(csv_parser_td *csv_parser, uint64_t start,
+        bool found)
+{
+    uint64_t elapsed = s_latency_now() - start;
+
+    csv_latency_record(&csv_parser->latency[CSV_LATENCY_ALL], elapsed);
+    if (found && csv_parser->record_end >= 0) {
+        /* Size of the record as read, terminator included */
+        off_t len = csv_parser->record_end - csv_parser->record_offset;
+        csv_latency_class_td latency_cls = (len <= 256) ?
+            CSV_LATENCY_SMALL : (len <= 4096) ? CSV_LATENCY_MEDIUM :
+            (len <= 65536) ? CSV_LATENCY_LARGE : CSV_LATENCY_HUGE;
+        csv_latency_record(&csv_parser->latency[latency_cls], elapsed);
+    }
+}
+
+
+/* Get the fields of the current row without copying them */
+const csv_row_view_td *csv_parser_row_view(csv_parser_td *csv_parser)
+{
+    if (csv_parser == NULL) {
+        return NULL;
+    }
+
+    if (csv_parser->latency == NULL) {
+        return s_row_view(csv_parser);
+    }
+
+    uint64_t start = s_latency_now();
+    const csv_row_view_td *view = s_row_view(csv_parser);
+    s_latency_record(csv_parser, start, view != NULL);
+
+    return view;
+}
+
+
+/* Get the current row that it's being parsed */
+csv_row_td *csv_parser_row(csv_parser_td *csv_parser)
+{
+    if (csv_parser == NULL) {
+        return NULL;
+    }
+
+    uint64_t start = (csv_parser->latency) ? s_latency_now() : 0;
+    const csv_row_view_td *view = s_row_view(csv_parser);
+    csv_row_td *row = (view) ?
+        s_parse_line_to_row(view, &csv_parser->stats) : NULL;
+    if (csv_parser->latency != NULL) {
+        s_latency_record(csv_parser, start, row != NULL);
+    }
+
+    return row;
+}
+
+
+/* Skip records without splitting them into fields */
+size_t csv_parser_skip(csv_parser_td *csv_parser, size_t n)
+{
+    if (csv_parser == NULL || !s_open(csv_parser)) {
+        return 0;
+    }
+
+    /* The header isn't a record to skip */
+    if (csv_parser->has_header && csv_parser->header == NULL &&
+            csv_parser_header(csv_parser) == NULL) {
+        return 0;
+    }
+
+    return s_skip_records(csv_parser, n);
+}
+
+
+/* Follow the file as it's appended to, or stop following it */
+bool csv_parser_follow(csv_parser_td *csv_parser, bool follow,
+        int timeout_ms)
+{
+    if (csv_parser == NULL) {
+        return false;
+    }
+
+    if (follow && !s_cache_leave(csv_parser)) {
+        return false;
+    }
+    csv_parser->follow = follow;
+    csv_parser->follow_timeout = (timeout_ms < 0) ? -1 : timeout_ms;
+
+#if defined(__linux__)
+    if (follow && csv_parser->follow_fd == -1 &&
+            csv_parser->filename != NULL) {
+        /* Watched before reading on, so no append can be missed */
+        csv_parser->follow_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (csv_parser->follow_fd != -1 &&
+                inotify_add_watch(csv_parser->follow_fd,
+                    csv_parser->filename,
+                    IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF) == -1) {
+            /* Fall back to sleeping */
+            close(csv_parser->follow_fd);
+            csv_parser->follow_fd = -1;
+        }
+    } else if (!follow && csv_parser->follow_fd != -1) {
+        close(csv_parser->follow_fd);
+        csv_parser->follow_fd = -1;
+    }
+#endif
+
+    return true;
+}
+
+
+/* Get the counters of a parser */
+bool csv_parser_stats(const csv_parser_td *csv_parser, csv_stats_td *stats)
+{
+    if (csv_parser == NULL || stats == NULL) {
+        return false;
+    }
+
+#if defined(CSV_STATS)
+    *stats = csv_parser->stats;
+    stats->lines = csv_parser->scan.lines;
+    stats->skipped_lines += csv_parser->scan.skipped;
+
+    return true;
+#else
+    memset(stats, 0, sizeof(*stats));
+
+    return false;
+#endif
+}
+
+
+/* Read the records from the parse cache of the file */
+bool csv_parser_cache(csv_parser_td *csv_parser, const char *dir)
+{
+    char delim[2];
+
+    if (csv_parser == NULL || csv_parser->follow || csv_parser->raw.keep ||
+            !s_open(csv_parser)) {
+        return false;
+    }
+
+    if (csv_parser->cache == NULL) {
+        delim[0] = csv_parser->delim;
+        delim[1] = '\0';
+        csv_parser->cache = csv_cache_load(csv_parser->filename,
+                csv_parser->delim, dir);
+        if (csv_parser->cache == NULL &&
+                csv_cache_build(csv_parser->filename, delim, dir)) {
+            csv_parser->cache = csv_cache_load(csv_parser->filename,
+                    csv_parser->delim, dir);
+        }
+        if (csv_parser->cache == NULL) {
+            return false;
+        }
+    }
+
+    /* Go on with the first record not read yet */
+    off_t at = csv_parser_checkpoint(csv_parser).offset;
+    const csv_cache_record_td *records = csv_parser->cache->records;
+    size_t lo = 0;
+    size_t hi = csv_parser->cache->num_records;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if ((off_t) records[mid].offset < at) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    csv_parser->cache_pos = lo;
+    csv_parser->cache_active = true;
+
+    return true;
+}
+
+
+/* Start or stop keeping every record as read */
+bool csv_parser_keep_raw(csv_parser_td *csv_parser, bool keep)
+{
+    if (csv_parser == NULL || (keep && !s_cache_leave(csv_parser))) {
+        return false;
+    }
+
+    csv_parser->raw.keep = keep;
+    csv_parser->raw.valid = false;
+
+    return true;
+}
+
+
+/* Get the current record as read */
+const char *csv_parser_raw_record(csv_parser_td *csv_parser,
+        size_t *len)
+{
+    csv_raw_td *raw = (csv_parser) ? &csv_parser->raw : NULL;
+
+    if (raw == NULL || !raw->valid || len == NULL) {
+        return NULL;
+    }
+
+    /* Only a last record at EOF can end within a quoted field, and a
+     * newline after it would become part of the field */
+    if (raw->split && raw->open_quote) {
+        return NULL;
+    }
+    if (!raw->split && memchr(raw->data, '\"', raw->len) != NULL) {
+        if (!s_raw_split(raw, csv_parser->delim) || raw->open_quote) {
+            return NULL;
+        }
+    }
+
+    *len = raw->len;
+
+    return raw->data;
+}
+
+
+/* Get a field of the current record as read */
+const char *csv_parser_raw_field(csv_parser_td *csv_parser, size_t index,
+        size_t *len)
+{
+    csv_raw_td *raw = (csv_parser) ? &csv_parser->raw : NULL;
+
+    if (raw == NULL || !raw->valid || len == NULL ||
+            (!raw->split && !s_raw_split(raw, csv_parser->delim)) ||
+            index >= raw->num_fields ||
+            (raw->open_quote && index == raw->num_fields - 1)) {
+        return NULL;
+    }
+
+    *len = raw->fields[index].end - raw->fields[index].start;
+
+    return raw->data + raw->fields[index].start;
+}
+
+
+/* Start or stop recording the latency of every row call */
+bool csv_parser_latency(csv_parser_td *csv_parser, bool enable)
+{
+    if (csv_parser == NULL) {
+        return false;
+    }
+
+    if (!enable) {
+        free(csv_parser->latency);
+        csv_parser->latency = NULL;
+    } else if (csv_parser->latency == NULL) {
+        csv_parser->latency = calloc(CSV_LATENCY_CLASSES,
+                sizeof(*csv_parser->latency));
+    }
+
+    return (csv_parser->latency != NULL) == enable;
+}
+
+
+/* Get the latency histogram of a class of calls */
+const csv_latency_td *csv_parser_latency_histogram(
+        const csv_parser_td *csv_parser, csv_latency_class_td latency_cls)
+{
+    if (csv_parser == NULL || csv_parser->latency == NULL ||
+            latency_cls < CSV_LATENCY_ALL ||
+            latency_cls >= CSV_LATENCY_CLASSES) {
+        return NULL;
+    }
+
+    return &csv_parser->latency[latency_cls];
+}
+
+
+/* Remove all the values of the latency histograms of a parser */
+void csv_parser_latency_reset(csv_parser_td *csv_parser)
+{
+    if (csv_parser == NULL || csv_parser->latency == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < CSV_LATENCY_CLASSES; ++i) {
+        csv_latency_reset(&csv_parser->latency[i]);
+    }
+}
+
+
+/* Continue parsing what was appended since the end was reached */
+csv_refresh_td csv_parser_refresh(csv_parser_td *csv_parser)
+{
+    struct stat st, fst;
+
+    if (csv_parser == NULL || !s_cache_leave(csv_parser) ||
+            !s_open(csv_parser) ||
+            stat(csv_parser->filename, &st) == -1 ||
+            fstat(fileno(csv_parser->fp), &fst) == -1) {
+        return CSV_REFRESH_ERROR;
+    }
+
+    /* Everything before the scan position was parsed (blank and comment
+     * lines after the last record included); only the record was hashed */
+    s_hash_last(csv_parser);
+    off_t end = csv_parser->buf_offset + (off_t) csv_parser->scan.pos;
+    off_t start = (csv_parser->record_hashed) ?
+        csv_parser->record_offset : end;
+    bool rewritten = (st.st_dev != fst.st_dev || st.st_ino != fst.st_ino ||
+            st.st_size < end);
+
+    size_t lines = csv_parser->scan.lines;
+    off_t resume = end;
+    if (!rewritten && start < end) {
+        /* The first bytes appended tell whether they go on with a last
+         * record that only EOF ended */
+        size_t len = (size_t) (end - start);
+        size_t extra = (st.st_size - end > 2) ? 2 :
+            (size_t) (st.st_size - end);
+        char *bytes = malloc(len + extra);
+        if (bytes == NULL) {
+            return CSV_REFRESH_ERROR;
+        }
+        size_t hashed = (size_t) (csv_parser->record_hash_end - start);
+        rewritten = (hashed > len ||
+                fseeko(csv_parser->fp, start, SEEK_SET) != 0 ||
+                fread(bytes, 1, len + extra, csv_parser->fp) !=
+                len + extra ||
+                csv_hash_bytes(bytes, hashed) != csv_parser->record_hash);
+
+        csv_scan_td probe;
+        csv_scan_init(&probe, csv_parser->delim, CSV_SCAN_LINE_START, 0);
+        if (!rewritten && extra > 0 &&
+                csv_scan(&probe, bytes, hashed, NULL, 1) == 0 &&
+                (probe.state == CSV_SCAN_QUOTED || (bytes[len] != '\n' &&
+                    (bytes[len] != '\r' || extra < 2 ||
+                     bytes[len + 1] != '\n')))) {
+            /* The last record goes on with the appended bytes: read it
+             * again whole, as a full parse would */
+            (void) csv_scan_flush(&probe, NULL);
+            lines -= probe.lines;
+            resume = start;
+        } else if (!rewritten && bytes[len - 1] != '\n' && lines > 0) {
+            /* An unterminated last line goes on with the appended bytes;
+             * if it's a blank or comment line, it's scanned again whole */
+            lines--;
+            size_t i = len;
+            while (i > hashed && bytes[i - 1] != '\n') {
+                i--;
+            }
+            resume = start + (off_t) i;
+        }
+        free(bytes);
+    }
+
+    if (rewritten) {
+        /* Start over with the file now at that path */
+        fclose(csv_parser->fp);
+        csv_parser->fp = NULL;
+        s_set_header(csv_parser, NULL);
+        csv_index_destroy(csv_parser->row_index);
+        csv_parser->row_index = NULL;
+        csv_parser->row_index_loaded = false;
+        csv_parser->record_offset = 0;
+        return s_reposition(csv_parser, 0, 0) ?
+            CSV_REFRESH_RESET : CSV_REFRESH_ERROR;
+    }
+
+    if (st.st_size == end) {
+        /* Stay at EOF, with the last record still known, so that what's
+         * appended later is checked against it */
+        return (fseeko(csv_parser->fp, csv_parser->buf_offset +
+                    (off_t) csv_parser->buf_len, SEEK_SET) == 0) ?
+            CSV_REFRESH_UNCHANGED : CSV_REFRESH_ERROR;
+    }
+
+    return s_reposition(csv_parser, resume, lines) ?
+        CSV_REFRESH_APPENDED : CSV_REFRESH_ERROR;
+}
+
+
+/* Get the file offset of the last record read */
+off_t csv_parser_offset(const csv_parser_td *csv_parser)
+{
+    return (csv_parser) ? csv_parser->record_offset : -1;
+}
+
+
+/* Get the bytes of the file taken by the current record */
+bool csv_parser_record_span(const csv_parser_td *csv_parser,
+        off_t *offset, size_t *len, bool *newline)
+{
+    if (csv_parser == NULL || offset == NULL || len == NULL ||
+            csv_parser->record_end < 0) {
+        return false;
+    }
+
+    *offset = csv_parser->record_offset;
+    *len = (size_t) (csv_parser->record_end - csv_parser->record_offset);
+    if (newline != NULL) {
+        *newline = csv_parser->record_newline;
+    }
+
+    return true;
+}
+
+
+/* Get the position where to resume parsing after the last record read */
+csv_checkpoint_td csv_parser_checkpoint(const csv_parser_td *csv_parser)
+{
+    csv_checkpoint_td checkpoint = { -1, 0 };
+
+    if (csv_parser != NULL && csv_parser->cache_active) {
+        size_t pos = csv_parser->cache_pos;
+        const csv_cache_record_td *last = (pos > 0) ?
+            &csv_parser->cache->records[pos - 1] : NULL;
+        checkpoint.offset = (last) ? (off_t) last->end : 0;
+        checkpoint.line_no = (last) ? (size_t) last->lines : 0;
+    } else if (csv_parser != NULL) {
+        checkpoint.offset = csv_parser->buf_offset +
+            (off_t) csv_parser->scan.pos;
+        checkpoint.line_no = csv_parser->scan.lines;
+    }
+
+    return checkpoint;
+}
+
+
+/* Resume parsing at a checkpoint */
+bool csv_parser_resume(csv_parser_td *csv_parser, off_t offset,
+        size_t line_no, const csv_row_td *header)
+{
+    if (csv_parser == NULL || offset < 0) {
+        return false;
+    }
+
+    if (offset == 0) {
+        /* Start over, header included */
+        s_set_header(csv_parser, NULL);
+        return s_reposition(csv_parser, 0, 0);
+    }
+
+    if (csv_parser->has_header && header != NULL) {
+        csv_field_td *fields =
+            malloc(sizeof(csv_field_td) * (header->num_fields + 1));
+        if (fields == NULL) {
+            return false;
+        }
+        for (size_t i = 0; i < header->num_fields; ++i) {
+            fields[i].data = header->fields[i];
+            fields[i].len = strlen(header->fields[i]);
+        }
+        csv_row_view_td view = { fields, header->num_fields };
+        csv_row_td *copy = s_parse_line_to_row(&view, &csv_parser->stats);
+        free(fields);
+        if (copy == NULL) {
+            return false;
+        }
+        s_set_header(csv_parser, copy);
+    } else if (csv_parser->has_header &&
+            csv_parser_header(csv_parser) == NULL) {
+        return false;
+    }
+
+    return s_reposition(csv_parser, offset, line_no);
+}
+
+
+/* Move the parser to a row, so that it's the next one read */
+bool csv_parser_seek_row(csv_parser_td *csv_parser, size_t n)
+{
+    off_t offset = 0;
+    size_t lines = 0;
+
+    if (csv_parser == NULL) {
+        return false;
+    }
+    if (csv_parser->has_header && csv_parser_header(csv_parser) == NULL) {
+        return false;
+    }
+
+    if (!csv_parser->row_index_loaded) {
+        csv_parser->row_index = csv_index_load(csv_parser->filename,
+                csv_parser->delim);
+        csv_parser->row_index_loaded = true;
+    }
+
+    /* Records are counted from the start of the file, header included */
+    size_t skip = n + ((csv_parser->has_header) ? 1 : 0);
+    if (csv_parser->cache_active) {
+        const csv_cache_td *cache = csv_parser->cache;
+        bool found = (skip < cache->num_records);
+        csv_parser->cache_pos = (found) ? skip : cache->num_records;
+        csv_parser->line_no = (!found) ?
+            (size_t) cache->records[cache->num_records].lines :
+            (skip > 0) ? (size_t) cache->records[skip - 1].lines : 0;
+        csv_parser->record_end = -1;
+        return found;
+    }
+    const csv_index_td *index = csv_parser->row_index;
+    if (index != NULL) {
+        if (skip >= index->num_records) {
+            return false;
+        }
+        const csv_index_sample_td *sample =
+            &index->samples[(size_t) (skip / index->every)];
+        offset = (off_t) sample->offset;
+        lines = (size_t) sample->lines;
+        skip = (size_t) (skip % index->every);
+    }
+
+    /* Without an index, the record count is only known by reading on */
+    return s_reposition(csv_parser, offset, lines) &&
+        s_skip_records(csv_parser, skip) == skip &&
+        (index != NULL || s_record_follows(csv_parser));
 }
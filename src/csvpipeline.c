@@ -0,0 +1,655 @@
+/**
+ * @file csvpipeline.c
+ *
+ * @brief Reader, parsers and consumer pipeline implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <errno.h>      /* errno, EINTR */
+#include <fcntl.h>      /* open, O_RDONLY */
+#include <pthread.h>    /* pthread_* */
+#include <sched.h>      /* sched_yield */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdlib.h>     /* malloc, calloc, free, NULL */
+#include <string.h>     /* memcpy */
+#include <time.h>       /* nanosleep */
+#include <unistd.h>     /* read, close */
+
+/* Local includes */
+#include <csvparallel.h>
+#include <csvparser.h>
+#include <csvpipeline.h>
+#include <csvutil.h>
+
+
+/**
+ * @brief Wait a little before polling a ring again
+ *
+ * Spins first, then yields the processor, and finally sleeps, so that
+ * an idle stage doesn't keep a core busy.
+ *
+ * @param spins Number of times it was called while waiting for the same
+ *              thing; reset it to @c 0 once the wait is over
+ */
+static void s_backoff(unsigned *spins)
+{
+    if (*spins < 64) {
+        (*spins)++;
+    } else if (*spins < 128) {
+        (*spins)++;
+        sched_yield();
+    } else {
+        struct timespec ts = { 0, 50000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+
+/**
+ * @brief Tell whether a flag of the pipeline is set
+ *
+ * @param flag Flag to read
+ *
+ * @return @c true if set
+ */
+static bool s_flag(const int *flag)
+{
+    return __atomic_load_n(flag, __ATOMIC_ACQUIRE) != 0;
+}
+
+
+/**
+ * @brief Set a flag of the pipeline
+ *
+ * @param flag Flag to set
+ */
+static void s_set_flag(int *flag)
+{
+    __atomic_store_n(flag, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Remove an item from a ring, waiting while it's empty
+ *
+ * @param csv_pipeline Pipelined CSV parser
+ * @param ring         Ring where to remove the item from
+ *
+ * @return Item removed, or @c NULL if the pipeline has to stop
+ */
+static void *s_wait_pop(csv_pipeline_td *csv_pipeline, csv_ring_td *ring)
+{
+    unsigned spins = 0;
+
+    for (;;) {
+        void *item = csv_ring_pop(ring);
+        if (item != NULL) {
+            return item;
+        }
+        if (s_flag(&csv_pipeline->stop)) {
+            return NULL;
+        }
+        s_backoff(&spins);
+    }
+}
+
+
+/**
+ * @brief Hand a block of whole records to the parsers and the consumer
+ *
+ * @param csv_pipeline Pipelined CSV parser
+ * @param block        Block to publish
+ */
+static void s_publish(csv_pipeline_td *csv_pipeline, csv_block_td *block)
+{
+    unsigned spins = 0;
+
+    __atomic_store_n(&block->ready, 0, __ATOMIC_RELAXED);
+
+    /* Neither ring holds more than every block, so this never waits */
+    while (!csv_ring_push(&csv_pipeline->order_ring, block)) {
+        s_backoff(&spins);
+    }
+    while (!csv_ring_push(&csv_pipeline->work_ring, block)) {
+        s_backoff(&spins);
+    }
+}
+
+
+/**
+ * @brief Locate the records read into a block
+ *
+ * @param block Block being filled
+ * @param scan  Scanner over the block
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_scan_block(csv_block_td *block, csv_scan_td *scan)
+{
+    do {
+        if (!csv_reserve(&block->spans, &block->spans_cap,
+                    block->num_spans + 1, sizeof(csv_span_td))) {
+            return false;
+        }
+        block->num_spans += csv_scan(scan, block->data, block->len,
+                block->spans + block->num_spans,
+                block->spans_cap - block->num_spans);
+    } while (scan->pos < block->len);
+
+    return true;
+}
+
+
+/**
+ * @brief Reader thread: fill blocks that end at a record boundary
+ *
+ * The unfinished record at the end of a full block is moved to the next
+ * block.  One byte is always kept spare to null-terminate the last
+ * record of the file.
+ *
+ * @param arg Pipelined CSV parser
+ *
+ * @return Always @c NULL
+ */
+static void *s_reader(void *arg)
+{
+    csv_pipeline_td *csv_pipeline = arg;
+    csv_scan_td scan;
+    csv_block_td *block;
+
+    csv_scan_init(&scan, csv_pipeline->delim, CSV_SCAN_LINE_START, 0);
+    block = s_wait_pop(csv_pipeline, &csv_pipeline->free_ring);
+
+    while (block != NULL) {
+        if (block->len + 1 >= block->cap &&
+                !csv_reserve(&block->data, &block->cap,
+                    (block->cap) ? block->cap * 2 :
+                    csv_pipeline->block_size + 1, 1)) {
+            s_set_flag(&csv_pipeline->failed);
+            break;
+        }
+
+        ssize_t n = read(csv_pipeline->fd, block->data + block->len,
+                block->cap - block->len - 1);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0) {
+            s_set_flag(&csv_pipeline->failed);
+            break;
+        } else if (n == 0) {
+            /* The last record may lack its newline */
+            csv_span_td span;
+            if (csv_scan_flush(&scan, &span)) {
+                if (!csv_reserve(&block->spans, &block->spans_cap,
+                            block->num_spans + 1, sizeof(csv_span_td))) {
+                    s_set_flag(&csv_pipeline->failed);
+                    break;
+                }
+                block->spans[block->num_spans++] = span;
+            }
+            if (block->num_spans > 0) {
+                s_publish(csv_pipeline, block);
+            }
+            break;
+        }
+
+        block->len += (size_t) n;
+        if (!s_scan_block(block, &scan)) {
+            s_set_flag(&csv_pipeline->failed);
+            break;
+        }
+        if (block->len < csv_pipeline->block_size || block->num_spans == 0) {
+            continue;
+        }
+
+        /* Backpressure: wait until the consumer releases a block */
+        csv_block_td *next =
+            s_wait_pop(csv_pipeline, &csv_pipeline->free_ring);
+        if (next == NULL) {
+            break;
+        }
+
+        size_t tail = scan.start;
+        next->len = 0;
+        next->num_spans = 0;
+        if (!csv_reserve(&next->data, &next->cap,
+                    csv_pipeline->block_size + 1, 1) ||
+                !csv_reserve(&next->data, &next->cap,
+                    block->len - tail + 1, 1)) {
+            s_set_flag(&csv_pipeline->failed);
+            break;
+        }
+        memcpy(next->data, block->data + tail, block->len - tail);
+        next->len = block->len - tail;
+        block->len = tail;
+        csv_scan_shift(&scan, tail);
+
+        s_publish(csv_pipeline, block);
+        block = next;
+    }
+
+    s_set_flag(&csv_pipeline->done);
+
+    return NULL;
+}
+
+
+/**
+ * @brief Split the records of a block into fields, in place
+ *
+ * @param csv_pipeline Pipelined CSV parser
+ * @param block        Block to parse
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_parse_block(const csv_pipeline_td *csv_pipeline,
+        csv_block_td *block)
+{
+    size_t num_fields = 0;
+
+    if (!csv_reserve(&block->first_field, &block->records_cap,
+                block->num_spans + 1, sizeof(size_t))) {
+        return false;
+    }
+
+    for (size_t i = 0; i < block->num_spans; ++i) {
+        char *record = block->data + block->spans[i].start;
+        size_t len = block->spans[i].end - block->spans[i].start;
+
+        record[(len > 0 && record[len - 1] == '\r') ? len - 1 : len] = '\0';
+        if (!csv_split_record(record, csv_pipeline->delim, &block->view,
+                    &block->view_cap) ||
+                !csv_reserve(&block->fields, &block->fields_cap,
+                    num_fields + block->view.num_fields,
+                    sizeof(csv_field_td))) {
+            return false;
+        }
+        memcpy(block->fields + num_fields, block->view.fields,
+                sizeof(csv_field_td) * block->view.num_fields);
+        block->first_field[i] = num_fields;
+        num_fields += block->view.num_fields;
+    }
+    block->first_field[block->num_spans] = num_fields;
+
+    return true;
+}
+
+
+/**
+ * @brief Parser thread: parse blocks until the reader is done
+ *
+ * @param arg Pipelined CSV parser
+ *
+ * @return Always @c NULL
+ */
+static void *s_parser(void *arg)
+{
+    csv_pipeline_td *csv_pipeline = arg;
+    unsigned spins = 0;
+
+    while (!s_flag(&csv_pipeline->stop)) {
+        bool done = s_flag(&csv_pipeline->done);
+        csv_block_td *block = csv_ring_pop(&csv_pipeline->work_ring);
+
+        if (block == NULL) {
+            if (done) {
+                break;
+            }
+            s_backoff(&spins);
+            continue;
+        }
+
+        spins = 0;
+        if (!s_parse_block(csv_pipeline, block)) {
+            s_set_flag(&csv_pipeline->failed);
+        }
+        __atomic_store_n(&block->ready, 1, __ATOMIC_RELEASE);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Release the block being consumed and take the next one
+ *
+ * @param csv_pipeline Pipelined CSV parser
+ *
+ * @return @c true on success, @c false on EOF or error
+ */
+static bool s_next_block(csv_pipeline_td *csv_pipeline)
+{
+    unsigned spins = 0;
+    csv_block_td *block;
+
+    if (csv_pipeline->current != NULL) {
+        while (!csv_ring_push(&csv_pipeline->free_ring,
+                    csv_pipeline->current)) {
+            s_backoff(&spins);
+        }
+        csv_pipeline->current = NULL;
+    }
+
+    for (;;) {
+        bool done = s_flag(&csv_pipeline->done);
+        if (s_flag(&csv_pipeline->failed)) {
+            return false;
+        }
+        block = csv_ring_pop(&csv_pipeline->order_ring);
+        if (block != NULL) {
+            break;
+        } else if (done) {
+            return false;
+        }
+        s_backoff(&spins);
+    }
+
+    /* Blocks come in order; wait until this one is parsed */
+    spins = 0;
+    while (!s_flag(&block->ready)) {
+        if (s_flag(&csv_pipeline->failed)) {
+            return false;
+        }
+        s_backoff(&spins);
+    }
+    if (s_flag(&csv_pipeline->failed)) {
+        return false;
+    }
+
+    csv_pipeline->current = block;
+    csv_pipeline->consume_rec = 0;
+
+    if (!csv_pipeline->started) {
+        csv_pipeline->started = true;
+        if (csv_pipeline->has_header && block->num_spans > 0) {
+            csv_row_view_td view = {
+                block->fields, block->first_field[1]
+            };
+            csv_pipeline->header = csv_row_from_view(&view);
+            csv_pipeline->consume_rec = 1;
+        }
+    }
+
+    return true;
+}
+
+
+/* Initialize a ring */
+bool csv_ring_init(csv_ring_td *ring, size_t cap)
+{
+    if (ring == NULL || cap == 0 || (cap & (cap - 1)) != 0) {
+        return false;
+    }
+
+    ring->cells = malloc(sizeof(csv_ring_cell_td) * cap);
+    if (ring->cells == NULL) {
+        return false;
+    }
+    for (size_t i = 0; i < cap; ++i) {
+        ring->cells[i].seq = i;
+        ring->cells[i].item = NULL;
+    }
+    ring->mask = cap - 1;
+    ring->head = 0;
+    ring->tail = 0;
+
+    return true;
+}
+
+
+/* Deallocate the cells of a ring */
+void csv_ring_destroy(csv_ring_td *ring)
+{
+    if (ring != NULL) {
+        free(ring->cells);
+        ring->cells = NULL;
+    }
+}
+
+
+/* Add an item to a ring, without waiting */
+bool csv_ring_push(csv_ring_td *ring, void *item)
+{
+    csv_ring_cell_td *cell;
+    size_t pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == pos) {
+            /* The cell is free for this turn; claim it */
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1,
+                        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (seq - pos > (size_t) -1 / 2) {
+            /* Still holding the item of the previous lap: full */
+            return false;
+        } else {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->item = item;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+
+/* Remove the oldest item of a ring, without waiting */
+void *csv_ring_pop(csv_ring_td *ring)
+{
+    csv_ring_cell_td *cell;
+    size_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == pos + 1) {
+            /* The cell holds the item for this turn; claim it */
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1,
+                        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (seq - (pos + 1) > (size_t) -1 / 2) {
+            /* Not filled yet for this turn: empty */
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    void *item = cell->item;
+    __atomic_store_n(&cell->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+
+    return item;
+}
+
+
+/* Initialize the pipelined CSV parser and start its threads */
+csv_pipeline_td *csv_pipeline_init(const char *filename, const char *delim,
+        bool has_header, size_t num_parsers)
+{
+    if (filename == NULL) {
+        return NULL;
+    }
+
+    csv_pipeline_td *csv_pipeline = calloc(1, sizeof(csv_pipeline_td));
+    if (csv_pipeline == NULL) {
+        return NULL;
+    }
+
+    csv_pipeline->delim = csv_parser_delim(delim);
+    csv_pipeline->has_header = has_header;
+    csv_pipeline->block_size = CSV_PIPELINE_BLOCK;
+    csv_pipeline->fd = open(filename, O_RDONLY);
+    if (csv_pipeline->fd == -1) {
+        free(csv_pipeline);
+        return NULL;
+    }
+
+    if (num_parsers == 0) {
+        size_t cpus = csv_parallel_num_cpus();
+        num_parsers = (cpus > 1) ? cpus - 1 : 1;
+    }
+
+    /* Enough blocks for every parser to hold one while the reader fills
+     * and the consumer drains others */
+    csv_pipeline->num_blocks = 4;
+    while (csv_pipeline->num_blocks < 2 * (num_parsers + 1)) {
+        csv_pipeline->num_blocks *= 2;
+    }
+    csv_pipeline->blocks = calloc(csv_pipeline->num_blocks,
+            sizeof(csv_block_td));
+    csv_pipeline->parsers = malloc(sizeof(pthread_t) * num_parsers);
+    if (csv_pipeline->blocks == NULL || csv_pipeline->parsers == NULL ||
+            !csv_ring_init(&csv_pipeline->free_ring,
+                csv_pipeline->num_blocks) ||
+            !csv_ring_init(&csv_pipeline->work_ring,
+                csv_pipeline->num_blocks) ||
+            !csv_ring_init(&csv_pipeline->order_ring,
+                csv_pipeline->num_blocks)) {
+        csv_pipeline_destroy(csv_pipeline);
+        return NULL;
+    }
+    for (size_t i = 0; i < csv_pipeline->num_blocks; ++i) {
+        csv_ring_push(&csv_pipeline->free_ring, &csv_pipeline->blocks[i]);
+    }
+
+    for (size_t i = 0; i < num_parsers; ++i) {
+        if (pthread_create(&csv_pipeline->parsers[i], NULL, s_parser,
+                    csv_pipeline) != 0) {
+            break;
+        }
+        csv_pipeline->num_parsers++;
+    }
+    csv_pipeline->reader_started = (csv_pipeline->num_parsers > 0 &&
+            pthread_create(&csv_pipeline->reader, NULL, s_reader,
+                csv_pipeline) == 0);
+    if (!csv_pipeline->reader_started) {
+        csv_pipeline_destroy(csv_pipeline);
+        return NULL;
+    }
+
+    return csv_pipeline;
+}
+
+
+/* Stop the threads and deallocate the pipelined CSV parser */
+void csv_pipeline_destroy(csv_pipeline_td *csv_pipeline)
+{
+    if (csv_pipeline == NULL) {
+        return;
+    }
+
+    s_set_flag(&csv_pipeline->stop);
+    if (csv_pipeline->reader_started) {
+        pthread_join(csv_pipeline->reader, NULL);
+    }
+    for (size_t i = 0; i < csv_pipeline->num_parsers; ++i) {
+        pthread_join(csv_pipeline->parsers[i], NULL);
+    }
+
+    for (size_t i = 0; csv_pipeline->blocks &&
+            i < csv_pipeline->num_blocks; ++i) {
+        csv_block_td *block = &csv_pipeline->blocks[i];
+        free(block->data);
+        free(block->spans);
+        free(block->fields);
+        free(block->first_field);
+        free(block->view.fields);
+    }
+
+    csv_ring_destroy(&csv_pipeline->free_ring);
+    csv_ring_destroy(&csv_pipeline->work_ring);
+    csv_ring_destroy(&csv_pipeline->order_ring);
+    if (csv_pipeline->fd != -1) {
+        close(csv_pipeline->fd);
+    }
+    csv_parser_destroy_row(csv_pipeline->header);
+    free(csv_pipeline->blocks);
+    free(csv_pipeline->parsers);
+    free(csv_pipeline);
+}
+
+
+/* Get the header of the CSV file, if any */
+const csv_row_td *csv_pipeline_header(csv_pipeline_td *csv_pipeline)
+{
+    if (csv_pipeline == NULL) {
+        return NULL;
+    }
+
+    if (!csv_pipeline->started && csv_pipeline->current == NULL) {
+        s_next_block(csv_pipeline);
+    }
+
+    return csv_pipeline->header;
+}
+
+
+/* Get the next row without copying its fields */
+const csv_row_view_td *csv_pipeline_row_view(csv_pipeline_td *csv_pipeline)
+{
+    if (csv_pipeline == NULL) {
+        return NULL;
+    }
+
+    while (csv_pipeline->current == NULL || csv_pipeline->consume_rec ==
+            csv_pipeline->current->num_spans) {
+        if (!s_next_block(csv_pipeline)) {
+            return NULL;
+        }
+    }
+
+    csv_block_td *block = csv_pipeline->current;
+    size_t i = csv_pipeline->consume_rec++;
+    csv_pipeline->view.fields = block->fields + block->first_field[i];
+    csv_pipeline->view.num_fields =
+        block->first_field[i + 1] - block->first_field[i];
+
+    return &csv_pipeline->view;
+}
+
+
+/* Get the next row */
+csv_row_td *csv_pipeline_row(csv_pipeline_td *csv_pipeline)
+{
+    return csv_row_from_view(csv_pipeline_row_view(csv_pipeline));
+}
+
+
+/* Tell whether the pipeline stopped because of an error */
+bool csv_pipeline_failed(csv_pipeline_td *csv_pipeline)
+{
+    return csv_pipeline != NULL && s_flag(&csv_pipeline->failed);
+}
@@ -0,0 +1,526 @@
+/**
+ * @file csvpool.c
+ *
+ * @brief Work-stealing thread pool to parse many CSV files implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <fcntl.h>      /* open, O_RDONLY */
+#include <pthread.h>    /* pthread_* */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdlib.h>     /* malloc, calloc, realloc, free, NULL */
+#include <string.h>     /* memcpy */
+#include <sys/mman.h>   /* mmap, munmap, posix_madvise */
+#include <sys/stat.h>   /* stat, fstat, S_ISREG */
+#include <unistd.h>     /* close */
+
+/* Local includes */
+#include <csvparallel.h>
+#include <csvparser.h>
+#include <csvpool.h>
+
+
+/**
+ * @brief Add a task as the newest of a deque
+ *
+ * @param deque Deque where to add the task
+ * @param task  Task to add
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_deque_push(csv_deque_td *deque, csv_task_td *task)
+{
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->len == deque->cap) {
+        size_t cap = (deque->cap) ? deque->cap * 2 : 64;
+        csv_task_td **tasks = malloc(sizeof(csv_task_td *) * cap);
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            return false;
+        }
+        for (size_t i = 0; i < deque->len; ++i) {
+            tasks[i] = deque->tasks[(deque->head + i) % deque->cap];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->cap = cap;
+    }
+    deque->tasks[(deque->head + deque->len++) % deque->cap] = task;
+
+    pthread_mutex_unlock(&deque->lock);
+
+    return true;
+}
+
+
+/**
+ * @brief Remove a task from a deque
+ *
+ * @param deque  Deque where to remove the task from
+ * @param newest If @c true, take the newest task (the owner does, for
+ *               locality); otherwise, the oldest one (thieves do, as
+ *               it's likely the largest piece of work left)
+ *
+ * @return Task removed, or @c NULL if the deque is empty
+ */
+static csv_task_td *s_deque_take(csv_deque_td *deque, bool newest)
+{
+    csv_task_td *task = NULL;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->len > 0) {
+        if (newest) {
+            task = deque->tasks[(deque->head + --deque->len) % deque->cap];
+        } else {
+            task = deque->tasks[deque->head];
+            deque->head = (deque->head + 1) % deque->cap;
+            deque->len--;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return task;
+}
+
+
+/**
+ * @brief Queue a task in the deque of a worker
+ *
+ * @param pool   Pool of the worker
+ * @param worker Worker where to queue the task
+ * @param task   Task to queue
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_queue(csv_pool_td *pool, csv_worker_td *worker,
+        csv_task_td *task)
+{
+    /* Counted first, so that it can't finish before being counted */
+    pthread_mutex_lock(&pool->lock);
+    pool->active++;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!s_deque_push(&worker->deque, task)) {
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_broadcast(&pool->done_cond);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pthread_cond_signal(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    return true;
+}
+
+
+/**
+ * @brief Take a task from the own deque, or steal one from another
+ *
+ * @param worker Worker looking for a task
+ *
+ * @return Task taken, or @c NULL if every deque is empty
+ */
+static csv_task_td *s_take(csv_worker_td *worker)
+{
+    csv_pool_td *pool = worker->pool;
+    csv_task_td *task = s_deque_take(&worker->deque, true);
+
+    for (size_t i = 1; task == NULL && i < pool->num_workers; ++i) {
+        csv_worker_td *victim =
+            &pool->workers[(worker->id + i) % pool->num_workers];
+        task = s_deque_take(&victim->deque, false);
+    }
+
+    if (task != NULL) {
+        pthread_mutex_lock(&pool->lock);
+        pool->queued--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return task;
+}
+
+
+/**
+ * @brief Drop a reference to a job, freeing it with the last one
+ *
+ * @param job Job to release
+ */
+static void s_job_release(csv_pool_job_td *job)
+{
+    if (__atomic_sub_fetch(&job->pending, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    csv_record_index_destroy(&job->index);
+    if (job->data != NULL) {
+        munmap((void *) job->data, job->size);
+    }
+    if (job->fd != -1) {
+        close(job->fd);
+    }
+    free(job);
+}
+
+
+/**
+ * @brief Split a large file into chunk tasks for the own deque
+ *
+ * @param worker Worker running the file task
+ * @param job    File to split
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_split_file(csv_worker_td *worker, csv_pool_job_td *job)
+{
+    csv_parser_td *csv_parser = job->csv_parser;
+    struct stat st;
+
+    /* Parsing starts after the last record the parser returned */
+    if (csv_parser->has_header) {
+        csv_parser_header(csv_parser);
+    }
+    size_t begin = (size_t) csv_parser->buf_offset + csv_parser->scan.pos;
+
+    job->fd = open(csv_parser->filename, O_RDONLY);
+    if (job->fd == -1 || fstat(job->fd, &st) == -1) {
+        return false;
+    }
+    job->size = (size_t) st.st_size;
+    if (begin >= job->size) {
+        return true;
+    }
+
+    void *data = mmap(NULL, job->size, PROT_READ, MAP_PRIVATE, job->fd, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    job->data = data;
+    (void) posix_madvise(data, job->size, POSIX_MADV_SEQUENTIAL);
+
+    /* A sequential scan is much cheaper than parsing, and it makes the
+     * chunks independent of each other */
+    if (!csv_record_index_build(&job->index, job->data, begin, job->size,
+                csv_parser->delim, 1)) {
+        return false;
+    }
+
+    const csv_span_td *records = job->index.records;
+    size_t first = 0;
+    for (size_t i = 0; i < job->index.num_records; ++i) {
+        bool last = (i + 1 == job->index.num_records);
+        if (!last && records[i].end - records[first].start < CSV_POOL_CHUNK) {
+            continue;
+        }
+
+        csv_task_td *task = malloc(sizeof(csv_task_td));
+        if (task == NULL) {
+            return false;
+        }
+        task->job = job;
+        task->chunk = true;
+        task->first = first;
+        task->last = i + 1;
+
+        __atomic_add_fetch(&job->pending, 1, __ATOMIC_RELAXED);
+        if (!s_queue(worker->pool, worker, task)) {
+            __atomic_sub_fetch(&job->pending, 1, __ATOMIC_RELAXED);
+            free(task);
+            return false;
+        }
+        first = i + 1;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Run a whole-file task
+ *
+ * Small files (and anything that can't be mapped, like pipes) are
+ * parsed right away; large files are split.
+ *
+ * @param worker Worker running the task
+ * @param job    File to parse
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_run_file(csv_worker_td *worker, csv_pool_job_td *job)
+{
+    struct stat st;
+
+    if (stat(job->csv_parser->filename, &st) == 0 && S_ISREG(st.st_mode) &&
+            st.st_size >= CSV_POOL_SPLIT) {
+        return s_split_file(worker, job);
+    }
+
+    const csv_row_view_td *row;
+    while ((row = csv_parser_row_view(job->csv_parser)) != NULL) {
+        job->fn(row, job->arg);
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Run a chunk task: parse a range of records of a split file
+ *
+ * @param worker Worker running the task
+ * @param task   Task to run
+ *
+ * @return @c true on success, @c false on allocation failure
+ */
+static bool s_run_chunk(csv_worker_td *worker, const csv_task_td *task)
+{
+    const csv_pool_job_td *job = task->job;
+
+    for (size_t i = task->first; i < task->last; ++i) {
+        const csv_span_td *span = &job->index.records[i];
+        size_t len = span->end - span->start;
+
+        if (len + 1 > worker->buf_cap) {
+            char *buf = realloc(worker->buf, len + 1);
+            if (buf == NULL) {
+                return false;
+            }
+            worker->buf = buf;
+            worker->buf_cap = len + 1;
+        }
+        memcpy(worker->buf, job->data + span->start, len);
+        worker->buf[(len > 0 && worker->buf[len - 1] == '\r') ?
+            len - 1 : len] = '\0';
+
+        if (!csv_split_record(worker->buf, job->csv_parser->delim,
+                    &worker->view, &worker->view_cap)) {
+            return false;
+        }
+        job->fn(&worker->view, job->arg);
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Worker thread: run tasks until the pool stops
+ *
+ * @param arg Worker
+ *
+ * @return Always @c NULL
+ */
+static void *s_worker(void *arg)
+{
+    csv_worker_td *worker = arg;
+    csv_pool_td *pool = worker->pool;
+
+    for (;;) {
+        csv_task_td *task = s_take(worker);
+
+        if (task != NULL) {
+            bool ok = (task->chunk) ? s_run_chunk(worker, task) :
+                s_run_file(worker, task->job);
+            s_job_release(task->job);
+            free(task);
+
+            pthread_mutex_lock(&pool->lock);
+            pool->failed = pool->failed || !ok;
+            if (--pool->active == 0) {
+                pthread_cond_broadcast(&pool->done_cond);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->stop) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        bool stop = (pool->stop && pool->queued == 0);
+        pthread_mutex_unlock(&pool->lock);
+        if (stop) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Stop the workers and free the pool
+ *
+ * @param pool        Pool to free
+ * @param num_threads Number of worker threads running
+ */
+static void s_pool_free(csv_pool_td *pool, size_t num_threads)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    for (size_t i = 0; i < pool->num_workers; ++i) {
+        csv_worker_td *worker = &pool->workers[i];
+        pthread_mutex_destroy(&worker->deque.lock);
+        free(worker->deque.tasks);
+        free(worker->buf);
+        free(worker->view.fields);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->workers);
+    free(pool);
+}
+
+
+/* Initialize the pool and start its workers */
+csv_pool_td *csv_pool_init(size_t num_threads)
+{
+    if (num_threads == 0) {
+        num_threads = csv_parallel_num_cpus();
+    }
+
+    csv_pool_td *pool = calloc(1, sizeof(csv_pool_td));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->workers = calloc(num_threads, sizeof(csv_worker_td));
+    if (pool->workers == NULL) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pool->num_workers = num_threads;
+    for (size_t i = 0; i < num_threads; ++i) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        pthread_mutex_init(&pool->workers[i].deque.lock, NULL);
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        if (pthread_create(&pool->workers[i].thread, NULL, s_worker,
+                    &pool->workers[i]) != 0) {
+            s_pool_free(pool, i);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+
+/* Wait for the submitted files, stop the workers and deallocate the pool */
+void csv_pool_destroy(csv_pool_td *pool)
+{
+    if (pool != NULL) {
+        csv_pool_wait(pool);
+        s_pool_free(pool, pool->num_workers);
+    }
+}
+
+
+/* Submit a file to be parsed by the pool */
+bool csv_pool_submit(csv_pool_td *pool, csv_parser_td *csv_parser,
+        csv_pool_row_fn_td fn, void *arg)
+{
+    if (pool == NULL || csv_parser == NULL || fn == NULL) {
+        return false;
+    }
+
+    csv_pool_job_td *job = malloc(sizeof(csv_pool_job_td));
+    csv_task_td *task = malloc(sizeof(csv_task_td));
+    if (job == NULL || task == NULL) {
+        free(job);
+        free(task);
+        return false;
+    }
+
+    job->csv_parser = csv_parser;
+    job->fn = fn;
+    job->arg = arg;
+    job->fd = -1;
+    job->data = NULL;
+    job->size = 0;
+    csv_record_index_init(&job->index);
+    job->pending = 1;
+    task->job = job;
+    task->chunk = false;
+    task->first = task->last = 0;
+
+    /* Files are spread round-robin; stealing evens out the rest */
+    pthread_mutex_lock(&pool->lock);
+    csv_worker_td *worker = &pool->workers[pool->next_worker++ %
+        pool->num_workers];
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!s_queue(pool, worker, task)) {
+        free(job);
+        free(task);
+        return false;
+    }
+
+    return true;
+}
+
+
+/* Wait until every submitted file is parsed */
+bool csv_pool_wait(csv_pool_td *pool)
+{
+    if (pool == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    bool ok = !pool->failed;
+    pool->failed = false;
+    pthread_mutex_unlock(&pool->lock);
+
+    return ok;
+}
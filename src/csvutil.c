@@ -0,0 +1,87 @@
+/**
+ * @file csvutil.c
+ *
+ * @brief Helpers shared by the modules of the library implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/* System includes */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* uint64_t, UINT64_C */
+#include <stdlib.h>     /* realloc */
+#include <string.h>     /* memcpy */
+
+/* Local includes */
+#include <csvutil.h>
+
+
+/* Hash bytes, eight at a time */
+uint64_t csv_hash_bytes(const char *data, size_t len)
+{
+    const uint64_t m = UINT64_C(0x9e3779b97f4a7c15);
+    uint64_t h = (uint64_t) len * m;
+    uint64_t w;
+
+    for (; len >= 8; data += 8, len -= 8) {
+        memcpy(&w, data, 8);
+        h = (h ^ w) * m;
+        h ^= h >> 29;
+    }
+    if (len > 0) {
+        w = 0;
+        memcpy(&w, data, len);
+        h = (h ^ w) * m;
+        h ^= h >> 29;
+    }
+
+    h ^= h >> 32;
+    h *= UINT64_C(0xd6e8feb86659fd93);
+    h ^= h >> 32;
+
+    return h;
+}
+
+
+/* Grow an array, if needed, so that it holds a number of items */
+bool csv_reserve(void *array, size_t *cap, size_t need, size_t size)
+{
+    if (need <= *cap) {
+        return true;
+    }
+
+    size_t new_cap = (*cap) ? *cap : 256;
+    while (new_cap < need) {
+        new_cap *= 2;
+    }
+    void *grown = realloc(*(void **) array, new_cap * size);
+    if (grown == NULL) {
+        return false;
+    }
+    *(void **) array = grown;
+    *cap = new_cap;
+
+    return true;
+}
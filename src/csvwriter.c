@@ -0,0 +1,537 @@
+/**
+ * @file csvwriter.c
+ *
+ * @brief Buffered CSV writer implementation
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+
+/* System includes */
+#include <ctype.h>      /* isspace */
+#include <errno.h>      /* errno, EINTR */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* uint64_t, UINT64_C */
+#include <stdio.h>      /* FILE, fopen, fwrite, fflush, fclose, fileno */
+#include <stdlib.h>     /* malloc, free, NULL */
+#include <string.h>     /* memcpy, memchr, strlen */
+#include <sys/types.h>  /* off_t, ssize_t */
+#include <unistd.h>     /* pread, copy_file_range */
+#if defined(__linux__)
+#include <fcntl.h>      /* splice */
+#endif
+
+/* Local includes */
+#include <csvwriter.h>
+
+
+/* Size of the output buffer */
+#ifndef CSV_WRITE_BUF
+#define CSV_WRITE_BUF (256 * 1024)
+#endif
+
+
+/**
+ * @brief Test whether a field has to be quoted, eight bytes at a time
+ *
+ * Words without any delimiter, quote, CR or LF are skipped whole, as in
+ * the record scanner: a byte of @c x = @c word ^ @c pattern is zero
+ * where they match, and @c (x - 0x01..01) & ~x & 0x80..80 is not zero
+ * iff some byte of @c x is zero.
+ *
+ * @param data  Bytes of the field
+ * @param len   Number of bytes of the field
+ * @param delim Delimiter between fields
+ *
+ * @return @c true if the field contains any of those bytes
+ */
+static bool s_has_special(const char *data, size_t len, char delim)
+{
+    const uint64_t ones = UINT64_C(0x0101010101010101);
+    const uint64_t highs = UINT64_C(0x8080808080808080);
+    const uint64_t pattern_delim = ones * (unsigned char) delim;
+    const uint64_t pattern_quote = ones * (unsigned char) '\"';
+    const uint64_t pattern_cr = ones * (unsigned char) '\r';
+    const uint64_t pattern_lf = ones * (unsigned char) '\n';
+    size_t pos = 0;
+
+    for (; len - pos >= sizeof(uint64_t); pos += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + pos, sizeof(uint64_t));
+
+        uint64_t xd = word ^ pattern_delim;
+        uint64_t xq = word ^ pattern_quote;
+        uint64_t xc = word ^ pattern_cr;
+        uint64_t xl = word ^ pattern_lf;
+        if (((xd - ones) & ~xd & highs) || ((xq - ones) & ~xq & highs) ||
+                ((xc - ones) & ~xc & highs) || ((xl - ones) & ~xl & highs)) {
+            return true;
+        }
+    }
+
+    for (; pos < len; ++pos) {
+        char c = data[pos];
+        if (c == delim || c == '\"' || c == '\r' || c == '\n') {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Copy the pending run of records from their file to the stream
+ *
+ * The stream is flushed, and the bytes are copied within the kernel
+ * when possible: with @c copy_file_range() between files, or with
+ * @c splice() into a pipe.  Otherwise (or if those fail) they are read
+ * into the empty output buffer, and written from there.
+ *
+ * @param csv_writer CSV writer with a pending run, and an empty buffer
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_copy_run(csv_writer_td *csv_writer)
+{
+    int in_fd = csv_writer->run_fd;
+    off_t offset = csv_writer->run_start;
+    size_t len = (size_t) (csv_writer->run_end - csv_writer->run_start);
+
+    csv_writer->run_fd = -1;
+    if (fflush(csv_writer->fp) != 0) {
+        csv_writer->failed = true;
+        return false;
+    }
+
+#if defined(__linux__)
+    int out_fd = fileno(csv_writer->fp);
+    while (len > 0 && (csv_writer->try_copy_range ||
+                csv_writer->try_splice)) {
+        loff_t in_off = offset;
+        ssize_t n = (csv_writer->try_copy_range) ?
+            copy_file_range(in_fd, &in_off, out_fd, NULL, len, 0) :
+            splice(in_fd, &in_off, out_fd, NULL, len, 0);
+        if (n > 0) {
+            offset += n;
+            len -= (size_t) n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (csv_writer->try_copy_range) {
+            /* Not between these files (a pipe, another file system on
+             * older kernels...): the bytes left go the next way */
+            csv_writer->try_copy_range = false;
+        } else {
+            csv_writer->try_splice = false;
+        }
+    }
+#endif
+
+    while (len > 0) {
+        size_t chunk = (len < csv_writer->buf_cap) ?
+            len : csv_writer->buf_cap;
+        ssize_t n = pread(in_fd, csv_writer->buf, chunk, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0 || fwrite(csv_writer->buf, 1, (size_t) n,
+                    csv_writer->fp) != (size_t) n) {
+            csv_writer->failed = true;
+            return false;
+        }
+        offset += n;
+        len -= (size_t) n;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Write the buffered bytes to the stream, then the pending run
+ *        of records (if any)
+ *
+ * @param csv_writer CSV writer whose buffer to write
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_drain(csv_writer_td *csv_writer)
+{
+    if (csv_writer->buf_len > 0) {
+        if (fwrite(csv_writer->buf, 1, csv_writer->buf_len, csv_writer->fp)
+                != csv_writer->buf_len) {
+            csv_writer->failed = true;
+        }
+        csv_writer->buf_len = 0;
+    }
+    if (csv_writer->run_fd >= 0 && !csv_writer->failed) {
+        (void) s_copy_run(csv_writer);
+    }
+
+    return !csv_writer->failed;
+}
+
+
+/**
+ * @brief Append bytes to the output buffer, draining it when full
+ *
+ * @param csv_writer CSV writer where to write
+ * @param data       Bytes to write
+ * @param len        Number of bytes to write
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_put(csv_writer_td *csv_writer, const char *data, size_t len)
+{
+    /* Bytes after a run of records go after it */
+    if (csv_writer->run_fd >= 0 && !s_drain(csv_writer)) {
+        return false;
+    }
+
+    if (len > csv_writer->buf_cap - csv_writer->buf_len) {
+        if (!s_drain(csv_writer)) {
+            return false;
+        }
+        if (len >= csv_writer->buf_cap) {
+            /* Too large to be worth copying */
+            if (fwrite(data, 1, len, csv_writer->fp) != len) {
+                csv_writer->failed = true;
+            }
+            return !csv_writer->failed;
+        }
+    }
+
+    memcpy(csv_writer->buf + csv_writer->buf_len, data, len);
+    csv_writer->buf_len += len;
+
+    return true;
+}
+
+
+/**
+ * @brief Append a single byte to the output buffer
+ *
+ * @param csv_writer CSV writer where to write
+ * @param c          Byte to write
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_put_char(csv_writer_td *csv_writer, char c)
+{
+    if ((csv_writer->buf_len == csv_writer->buf_cap ||
+                csv_writer->run_fd >= 0) && !s_drain(csv_writer)) {
+        return false;
+    }
+    csv_writer->buf[csv_writer->buf_len++] = c;
+
+    return true;
+}
+
+
+/**
+ * @brief Initialize a CSV writer over a stream
+ *
+ * @param fp     Stream where to write
+ * @param own_fp Whether the writer closes @p fp when destroyed
+ * @param delim  Delimiter between fields
+ *
+ * @return Pointer to the CSV writer, or @c NULL otherwise
+ */
+static csv_writer_td *s_writer_init(FILE *fp, bool own_fp,
+        const char *delim)
+{
+    csv_writer_td *csv_writer = malloc(sizeof(csv_writer_td));
+    if (csv_writer == NULL) {
+        return NULL;
+    }
+
+    csv_writer->buf = malloc(CSV_WRITE_BUF);
+    if (csv_writer->buf == NULL) {
+        free(csv_writer);
+        return NULL;
+    }
+
+    csv_writer->fp = fp;
+    csv_writer->own_fp = own_fp;
+    csv_writer->delim = csv_parser_delim(delim);
+    csv_writer->buf_len = 0;
+    csv_writer->buf_cap = CSV_WRITE_BUF;
+    csv_writer->num_fields = 0;
+    csv_writer->first_empty = false;
+    csv_writer->failed = false;
+    csv_writer->run_fd = -1;
+    csv_writer->run_start = 0;
+    csv_writer->run_end = 0;
+    csv_writer->try_copy_range = true;
+    csv_writer->try_splice = true;
+
+    return csv_writer;
+}
+
+
+/* Initialize a CSV writer that creates (or truncates) a file */
+csv_writer_td *csv_writer_init(const char *filename, const char *delim)
+{
+    if (filename == NULL) {
+        return NULL;
+    }
+
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    csv_writer_td *csv_writer = s_writer_init(fp, true, delim);
+    if (csv_writer == NULL) {
+        fclose(fp);
+    }
+
+    return csv_writer;
+}
+
+
+/* Initialize a CSV writer over an open stream */
+csv_writer_td *csv_writer_init_fp(FILE *fp, const char *delim)
+{
+    if (fp == NULL) {
+        return NULL;
+    }
+
+    return s_writer_init(fp, false, delim);
+}
+
+
+/* Flush and deallocate the CSV writer */
+void csv_writer_destroy(csv_writer_td *csv_writer)
+{
+    if (csv_writer == NULL) {
+        return;
+    }
+
+    (void) csv_writer_flush(csv_writer);
+    if (csv_writer->own_fp) {
+        fclose(csv_writer->fp);
+    }
+    free(csv_writer->buf);
+    free(csv_writer);
+}
+
+
+/* Write a field at the end of the current record */
+bool csv_writer_field(csv_writer_td *csv_writer, const char *data,
+        size_t len)
+{
+    if (csv_writer == NULL || (data == NULL && len > 0)) {
+        return false;
+    }
+
+    if (csv_writer->num_fields++ > 0 &&
+            !s_put_char(csv_writer, csv_writer->delim)) {
+        return false;
+    }
+
+    /* At the start of a line, whitespace, '#' or NUL would start
+     * a comment or a blank line; so would an empty field followed by
+     * a whitespace delimiter.  An empty only field is a blank line
+     * itself, but that's known at the end of the record */
+    bool first = (csv_writer->num_fields == 1);
+    bool quote = s_has_special(data, len, csv_writer->delim) ||
+        (first && len > 0 && (data[0] == '#' || data[0] == '\0' ||
+                              isspace((unsigned char) data[0]))) ||
+        (first && len == 0 && isspace((unsigned char) csv_writer->delim));
+    if (first) {
+        csv_writer->first_empty = (len == 0 && !quote);
+    }
+    if (!quote) {
+        return s_put(csv_writer, data, len);
+    }
+
+    /* Copy the runs between quotes, doubling every quote */
+    if (!s_put_char(csv_writer, '\"')) {
+        return false;
+    }
+    const char *end = data + len;
+    const char *q;
+    while ((q = memchr(data, '\"', (size_t) (end - data))) != NULL) {
+        if (!s_put(csv_writer, data, (size_t) (q - data) + 1) ||
+                !s_put_char(csv_writer, '\"')) {
+            return false;
+        }
+        data = q + 1;
+    }
+
+    return s_put(csv_writer, data, (size_t) (end - data)) &&
+        s_put_char(csv_writer, '\"');
+}
+
+
+/* Write a field as read, at the end of the current record */
+bool csv_writer_raw_field(csv_writer_td *csv_writer, const char *data,
+        size_t len)
+{
+    if (csv_writer == NULL || (data == NULL && len > 0)) {
+        return false;
+    }
+
+    /* A field that can't start a line is unquoted, so its bytes are its
+     * value: let it be quoted as any other; so is an unquoted one with
+     * a carriage return, which would end up before a newline as last */
+    if ((csv_writer->num_fields == 0 && (len == 0 || data[0] == '#' ||
+                    data[0] == '\0' || isspace((unsigned char) data[0]))) ||
+            (len > 0 && data[0] != '\"' && memchr(data, '\r', len))) {
+        return csv_writer_field(csv_writer, data, len);
+    }
+
+    if (csv_writer->num_fields++ > 0 &&
+            !s_put_char(csv_writer, csv_writer->delim)) {
+        return false;
+    }
+    if (csv_writer->num_fields == 1) {
+        csv_writer->first_empty = false;
+    }
+
+    return s_put(csv_writer, data, len);
+}
+
+
+/* Write a record as read */
+bool csv_writer_raw_record(csv_writer_td *csv_writer, const char *data,
+        size_t len)
+{
+    if (csv_writer == NULL || (data == NULL && len > 0) ||
+            csv_writer->num_fields > 0) {
+        return false;
+    }
+
+    return s_put(csv_writer, data, len) && s_put_char(csv_writer, '\n');
+}
+
+
+/* Copy the current record of a parser, as it is in its file */
+bool csv_writer_copy_record(csv_writer_td *csv_writer,
+        const csv_parser_td *csv_parser)
+{
+    off_t offset;
+    size_t len;
+    bool newline;
+
+    if (csv_writer == NULL || csv_parser == NULL ||
+            csv_parser->fp == NULL || csv_writer->num_fields > 0 ||
+            !csv_parser_record_span(csv_parser, &offset, &len, &newline)) {
+        return false;
+    }
+
+    /* Records right after the pending run extend it */
+    int fd = fileno(csv_parser->fp);
+    if (csv_writer->run_fd == fd && csv_writer->run_end == offset) {
+        csv_writer->run_end += (off_t) len;
+    } else {
+        if (!s_drain(csv_writer)) {
+            return false;
+        }
+        csv_writer->run_fd = fd;
+        csv_writer->run_start = offset;
+        csv_writer->run_end = offset + (off_t) len;
+    }
+
+    /* The last record of a file may lack its newline */
+    return newline || s_put_char(csv_writer, '\n');
+}
+
+
+/* End the current record */
+bool csv_writer_end_record(csv_writer_td *csv_writer)
+{
+    if (csv_writer == NULL) {
+        return false;
+    }
+
+    /* A record of a single empty field would be an empty line */
+    if (csv_writer->num_fields == 1 && csv_writer->first_empty &&
+            !s_put(csv_writer, "\"\"", 2)) {
+        return false;
+    }
+    csv_writer->num_fields = 0;
+
+    return s_put_char(csv_writer, '\n');
+}
+
+
+/* Write a whole row as a record */
+bool csv_writer_row(csv_writer_td *csv_writer, const csv_row_td *row)
+{
+    if (csv_writer == NULL || row == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < row->num_fields; ++i) {
+        const char *field = row->fields[i];
+        if (!csv_writer_field(csv_writer, field,
+                    (field) ? strlen(field) : 0)) {
+            return false;
+        }
+    }
+
+    return csv_writer_end_record(csv_writer);
+}
+
+
+/* Write a whole row view as a record */
+bool csv_writer_row_view(csv_writer_td *csv_writer,
+        const csv_row_view_td *view)
+{
+    if (csv_writer == NULL || view == NULL) {
+        return false;
+    }
+
+    for (size_t i = 0; i < view->num_fields; ++i) {
+        if (!csv_writer_field(csv_writer, view->fields[i].data,
+                    view->fields[i].len)) {
+            return false;
+        }
+    }
+
+    return csv_writer_end_record(csv_writer);
+}
+
+
+/* Write the buffered bytes to the stream, and flush it */
+bool csv_writer_flush(csv_writer_td *csv_writer)
+{
+    if (csv_writer == NULL) {
+        return false;
+    }
+
+    if (s_drain(csv_writer) && fflush(csv_writer->fp) != 0) {
+        csv_writer->failed = true;
+    }
+
+    return !csv_writer->failed;
+}
@@ -8,29 +8,29 @@
 
 #include <stdbool.h>    /* true */
 #include <stdio.h>      /* printf */
-#include <stdlib.h>     /* atof */
 
 #include <csvparser.h>
+#include <csvschema.h>
 
 
 int main(void)
 {
-    csv_row_td *row;
+    const csv_row_view_td *row;
     csv_parser_td *csvparser =
         csv_parser_init("data/example.csv",
                         CSV_DELIM_COMMA, CSV_HAS_HEADER);
 
-    while ((row = csv_parser_row(csvparser))) {
-        const char **row_fields = csv_parser_fields(row);
-
-    	printf("==NEW LINE==\n");
-        for (size_t i = 0 ; i < csv_parser_num_fields(row) ; ++i) {
-            printf("FIELD: %g\n", atof(row_fields[i]));
+    while ((row = csv_parser_row_view(csvparser))) {
+        printf("==NEW LINE==\n");
+        for (size_t i = 0 ; i < row->num_fields ; ++i) {
+            double value = 0.0;
+            (void) csv_parse_double(row->fields[i].data, row->fields[i].len,
+                    &value);
+            printf("FIELD: %g\n", value);
         }
-		printf("\n");
-        csv_parser_destroy_row(row);
+        printf("\n");
     }
     csv_parser_destroy(csvparser);
-	
+
     return 0;
 }
@@ -0,0 +1,972 @@
+/**
+ * @file csvtest.c
+ *
+ * @brief Regression cases of the parser
+ *
+ * Every case builds its input in a temporary file, and returns whether
+ * the parser behaved; the exit status tells whether all of them did.
+ *
+ * @author J. A. Corbal <jacorbal@gmail.com>
+ * @copyright Copyright (c) 2025, J. A. Corbal.
+ *            Licensed under the ISC License.  See `LICENSE` for details.
+ */
+/*
+ * ISC License
+ *
+ * Copyright (c) 2025, J. A. Corbal <jacorbal@gmail.com>
+ * 
+ * Permission to use, copy, modify, and/or distribute this software for
+ * any purpose with or without fee is hereby granted, provided that the
+ * above copyright notice and this permission notice appear in all
+ * copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+ * WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS.  IN NO EVENT SHALL THE
+ * AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR
+ * PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+
+/* System includes */
+#include <stdbool.h>    /* bool, true, false */
+#include <stdint.h>     /* int32_t, uint64_t, UINT64_C */
+#include <stdio.h>      /* FILE, fopen, fread, fwrite, snprintf, remove */
+#include <stdlib.h>     /* EXIT_SUCCESS, EXIT_FAILURE, mkstemp */
+#include <string.h>     /* strcmp, memcmp */
+#include <unistd.h>     /* close, truncate */
+
+/* Local includes */
+#include <csvcache.h>
+#include <csvindex.h>
+#include <csvparallel.h>
+#include <csvparser.h>
+#include <csvpipeline.h>
+#include <csvschema.h>
+#include <csvwriter.h>
+
+
+/**
+ * @typedef csv_test_td
+ *
+ * @brief Structure for a regression case
+ */
+typedef struct {
+    const char *name;               /**< Name of the case */
+    bool (*run)(const char *path);  /**< Case, given a scratch file */
+} csv_test_td;
+
+
+/**
+ * @brief Write (or append) a string to a file
+ *
+ * @param path Path to the file
+ * @param mode Mode to open it with ("wb" or "ab")
+ * @param data String to write
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_put_file(const char *path, const char *mode, const char *data)
+{
+    FILE *fp = fopen(path, mode);
+    if (fp == NULL) {
+        return false;
+    }
+    bool ok = fputs(data, fp) >= 0;
+
+    return (fclose(fp) == 0) && ok;
+}
+
+
+/**
+ * @brief Read the rest of the rows, and compare their first fields
+ *
+ * @param csv_parser CSV parser to read from
+ * @param expected   First field of every row expected, then @c NULL
+ *
+ * @return @c true if the rows are the expected ones, @c false otherwise
+ */
+static bool s_expect_rows(csv_parser_td *csv_parser, const char **expected)
+{
+    const csv_row_view_td *view;
+    size_t n = 0;
+
+    while ((view = csv_parser_row_view(csv_parser)) != NULL) {
+        if (expected[n] == NULL || view->num_fields == 0 ||
+                strcmp(view->fields[0].data, expected[n]) != 0) {
+            return false;
+        }
+        n++;
+    }
+
+    return expected[n] == NULL;
+}
+
+
+/**
+ * @brief Read a file to its end, append to it, and refresh the parser
+ *
+ * @param path     Scratch file
+ * @param initial  Contents of the file before appending
+ * @param appended Bytes appended
+ * @param expected First field of every row expected after refreshing,
+ *                 then @c NULL
+ *
+ * @return @c true if the refresh found the bytes appended, and only the
+ *         expected rows follow, @c false otherwise
+ */
+static bool s_refresh_case(const char *path, const char *initial,
+        const char *appended, const char **expected)
+{
+    if (!s_put_file(path, "wb", initial)) {
+        return false;
+    }
+
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+    bool ok = (csv_parser_header(csv_parser) != NULL);
+    while (ok && csv_parser_row_view(csv_parser) != NULL) {
+        /* Nothing to do */
+    }
+
+    ok = ok && s_put_file(path, "ab", appended) &&
+        csv_parser_refresh(csv_parser) == CSV_REFRESH_APPENDED &&
+        s_expect_rows(csv_parser, expected);
+    csv_parser_destroy(csv_parser);
+
+    return ok;
+}
+
+
+/**
+ * @brief Refresh after a trailing blank line
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_refresh_blank(const char *path)
+{
+    const char *expected[] = { "c", NULL };
+
+    return s_refresh_case(path, "h\na\nb\n\n", "c\n", expected);
+}
+
+
+/**
+ * @brief Refresh after a trailing comment line, terminated or not
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_refresh_comment(const char *path)
+{
+    const char *expected[] = { "c", NULL };
+
+    return s_refresh_case(path, "h\na\nb\n# x\n", "c\n", expected) &&
+        s_refresh_case(path, "h\na\nb\n# x", "y\nc\n", expected);
+}
+
+
+/**
+ * @brief Refresh after a last record without its final newline
+ *
+ * The record is read again whole if the bytes appended go on with it,
+ * even after a refresh that found nothing appended, and isn't if they
+ * terminate it.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_refresh_open(const char *path)
+{
+    const char *continued[] = { "3", "6", NULL };
+    const char *quoted[] = { "a\nb", "c", NULL };
+    const char *terminated[] = { "c", NULL };
+
+    bool ok = s_refresh_case(path, "h\n1,2\n3,4", "5\n6,7\n", continued) &&
+        s_refresh_case(path, "h\n\"a\n", "b\"\nc\n", quoted) &&
+        s_refresh_case(path, "h\na\nb", "\r\nc\n", terminated) &&
+        s_put_file(path, "wb", "h\n1,2\n3,4");
+
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+    const csv_row_view_td *view;
+    while (ok && (view = csv_parser_row_view(csv_parser)) != NULL) {
+        /* Nothing to do */
+    }
+    ok = ok && csv_parser_refresh(csv_parser) == CSV_REFRESH_UNCHANGED &&
+        s_put_file(path, "ab", "5\n6,7\n") &&
+        csv_parser_refresh(csv_parser) == CSV_REFRESH_APPENDED &&
+        (view = csv_parser_row_view(csv_parser)) != NULL &&
+        view->num_fields == 2 && strcmp(view->fields[1].data, "45") == 0 &&
+        csv_parser->line_no == 3 &&
+        s_expect_rows(csv_parser, continued + 1);
+    csv_parser_destroy(csv_parser);
+
+    return ok;
+}
+
+
+/**
+ * @brief Take a bare carriage return as data, as the scanner does
+ *
+ * A quoted field after it on the same line mustn't swallow the records
+ * that follow.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_bare_cr(const char *path)
+{
+    const char *expected[] = { "d", NULL };
+
+    if (!s_put_file(path, "wb", "a\rb,\"x\ny\",c\r\nd\n")) {
+        return false;
+    }
+
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", false);
+    const csv_row_view_td *view = csv_parser_row_view(csv_parser);
+    bool ok = (view != NULL && view->num_fields == 3 &&
+            strcmp(view->fields[0].data, "a\rb") == 0 &&
+            strcmp(view->fields[1].data, "x\ny") == 0 &&
+            strcmp(view->fields[2].data, "c") == 0 &&
+            s_expect_rows(csv_parser, expected));
+    csv_parser_destroy(csv_parser);
+
+    return ok;
+}
+
+
+/**
+ * @brief Count days since the epoch across the start of year 0000
+ *
+ * January and February count from the previous March, in year -1, which
+ * must be floored into the era before it.
+ *
+ * @param path Scratch file (unused)
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_date_year_zero(const char *path)
+{
+    static const struct {
+        const char *date;
+        int32_t days;
+    } cases[] = {
+        { "0000-01-01", -719528 },
+        { "0000-02-29", -719469 },
+        { "0000-03-01", -719468 },
+        { "1970-01-01", 0 },
+        { "2000-02-29", 11016 },
+    };
+
+    (void) path;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        int32_t days;
+        if (!csv_parse_date(cases[i].date, 10, &days) ||
+                days != cases[i].days) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Get the path of a file next to a scratch file
+ *
+ * @param buf    Buffer where to store the path
+ * @param size   Size of @p buf
+ * @param path   Scratch file
+ * @param suffix Suffix to append to @p path
+ *
+ * @return @c true on success, @c false if @p buf is too small
+ */
+static bool s_sidecar(char *buf, size_t size, const char *path,
+        const char *suffix)
+{
+    int len = snprintf(buf, size, "%s%s", path, suffix);
+
+    return len >= 0 && (size_t) len < size;
+}
+
+
+/**
+ * @brief Rewrite the index of a file, as if it sampled every record
+ *
+ * The header of the index built for the file is kept, so the size and
+ * modification time still match.
+ *
+ * @param path        Scratch file, already indexed
+ * @param num_records Number of records to claim
+ * @param num_samples Number of samples to claim
+ * @param offsets     Offset of every sample written
+ * @param n           Number of samples written
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_put_index(const char *path, uint64_t num_records,
+        uint64_t num_samples, const uint64_t *offsets, size_t n)
+{
+    char idx_path[64];
+    uint64_t head[8];
+
+    if (!s_sidecar(idx_path, sizeof(idx_path), path, CSV_INDEX_SUFFIX)) {
+        return false;
+    }
+    FILE *fp = fopen(idx_path, "r+b");
+    if (fp == NULL) {
+        return false;
+    }
+
+    bool ok = fread(head, sizeof(uint64_t), 8, fp) == 8;
+    head[4] = 1;
+    head[5] = num_records;
+    head[6] = num_samples;
+    ok = ok && fseek(fp, 0, SEEK_SET) == 0 &&
+        fwrite(head, sizeof(uint64_t), 8, fp) == 8;
+    for (size_t i = 0; ok && i < n; ++i) {
+        csv_index_sample_td sample = { offsets[i], i };
+        ok = fwrite(&sample, sizeof(sample), 1, fp) == 1;
+    }
+    ok = (fclose(fp) == 0) && ok;
+
+    /* Drop whatever followed the samples */
+    return ok && truncate(idx_path, (off_t) (sizeof(head) +
+                sizeof(csv_index_sample_td) * n)) == 0;
+}
+
+
+/**
+ * @brief Tell whether the index of a file loads
+ *
+ * @param path Scratch file
+ *
+ * @return @c true if it does, @c false otherwise
+ */
+static bool s_index_loads(const char *path)
+{
+    csv_index_td *index = csv_index_load(path, ',');
+    bool ok = (index != NULL);
+    csv_index_destroy(index);
+
+    return ok;
+}
+
+
+/**
+ * @brief Reject an index whose counts or samples don't fit the file
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_index_corrupt(const char *path)
+{
+    /* Records start at offsets 0, 2, 4 and 6 */
+    const uint64_t offsets[] = { 0, 2, 4, 6 };
+    const uint64_t decreasing[] = { 0, 4, 2, 6 };
+    const uint64_t outside[] = { 0, 2, 4, 60 };
+    const uint64_t huge = (UINT64_C(1) << 60) + 1;
+    const char *expected[] = { "c", NULL };
+    char idx_path[64];
+
+    bool ok = s_sidecar(idx_path, sizeof(idx_path), path, CSV_INDEX_SUFFIX) &&
+        s_put_file(path, "wb", "h\na\nb\nc\n") &&
+        csv_index_build(path, ",") && s_index_loads(path) &&
+        s_put_index(path, 4, 4, offsets, 4) && s_index_loads(path);
+
+    /* A count that wraps the size of the samples around */
+    ok = ok && s_put_index(path, huge, huge, offsets, 2) &&
+        !s_index_loads(path);
+    /* Fewer samples than counted */
+    ok = ok && s_put_index(path, 4, 4, offsets, 3) && !s_index_loads(path);
+    /* Samples out of order, or past the end of the file */
+    ok = ok && s_put_index(path, 4, 4, decreasing, 4) &&
+        !s_index_loads(path);
+    ok = ok && s_put_index(path, 4, 4, outside, 4) && !s_index_loads(path);
+
+    /* Seeking ignores the index then */
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+    ok = ok && csv_parser_seek_row(csv_parser, 2) &&
+        s_expect_rows(csv_parser, expected);
+    csv_parser_destroy(csv_parser);
+    remove(idx_path);
+
+    return ok;
+}
+
+
+/**
+ * @brief Seek to the last row and past it, with and without an index
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_seek_end(const char *path)
+{
+    const char *files[] = { "h\na\nb\nc\n\n# x\n", "h\na\nb\nc" };
+    const char *expected[] = { "c", NULL };
+    char idx_path[64];
+    bool ok = s_sidecar(idx_path, sizeof(idx_path), path, CSV_INDEX_SUFFIX);
+
+    for (size_t i = 0; ok && i < 4; ++i) {
+        ok = s_put_file(path, "wb", files[i / 2]) &&
+            (i % 2 == 0 || csv_index_build(path, ","));
+        csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+        ok = ok && !csv_parser_seek_row(csv_parser, 4) &&
+            !csv_parser_seek_row(csv_parser, 3) &&
+            csv_parser_seek_row(csv_parser, 2) &&
+            s_expect_rows(csv_parser, expected);
+        csv_parser_destroy(csv_parser);
+        remove(idx_path);
+    }
+
+    return ok;
+}
+
+
+/**
+ * @brief Infer types from as many rows as the sampling budget allows
+ *
+ * The file is larger than the parser's buffer, and a few values that
+ * aren't integers come after the first row, both at the start of the
+ * file and past its middle.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_infer_budget(const char *path)
+{
+    const size_t num_rows = 100000;
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    bool ok = fputs("a,b\n", fp) >= 0;
+    for (size_t i = 0; ok && i < num_rows; ++i) {
+        ok = fputs((i == 5) ? "1.5," : "1,", fp) >= 0 &&
+            fputs((i > num_rows / 2 && i % 50 == 0) ? "2.5\n" : "2\n",
+                    fp) >= 0;
+    }
+    ok = (fclose(fp) == 0) && ok;
+
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+    csv_schema_td *start = (ok) ? csv_infer_schema(csv_parser, 100) : NULL;
+    csv_schema_td *stripes = (ok) ?
+        csv_infer_schema_stripes(csv_parser, 4096, 1) : NULL;
+    ok = start != NULL && stripes != NULL &&
+        start->types[0] == CSV_TYPE_DOUBLE &&
+        start->types[1] == CSV_TYPE_INT64 &&
+        stripes->types[0] == CSV_TYPE_DOUBLE &&
+        stripes->types[1] == CSV_TYPE_DOUBLE;
+    csv_schema_destroy(start);
+    csv_schema_destroy(stripes);
+    csv_parser_destroy(csv_parser);
+
+    return ok;
+}
+
+
+/**
+ * @brief Overwrite some bytes of a file
+ *
+ * @param path   Path to the file
+ * @param offset Offset of the bytes
+ * @param data   Bytes to write
+ * @param len    Number of bytes to write
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_patch_file(const char *path, long offset, const void *data,
+        size_t len)
+{
+    FILE *fp = fopen(path, "r+b");
+    if (fp == NULL) {
+        return false;
+    }
+    bool ok = fseek(fp, offset, SEEK_SET) == 0 &&
+        fwrite(data, 1, len, fp) == len;
+
+    return (fclose(fp) == 0) && ok;
+}
+
+
+/**
+ * @brief Reject a parse cache whose indices or offsets are out of place
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_cache_corrupt(const char *path)
+{
+    const uint64_t far = UINT64_C(1) << 40;
+    const uint64_t zero = 0;
+    const char *expected[] = { "a", "1", NULL };
+    char cache_path[64];
+
+    bool ok = s_sidecar(cache_path, sizeof(cache_path), path,
+            CSV_CACHE_SUFFIX) &&
+        s_put_file(path, "wb", "h,i\na,\"b\"\"c\"\n1,2\n") &&
+        csv_cache_build(path, ",", NULL);
+
+    /* Where the offset of the first value, the first field of the
+     * second record and the null byte of the first value are stored */
+    csv_cache_td *cache = (ok) ? csv_cache_load(path, ',', NULL) : NULL;
+    ok = (cache != NULL);
+    long value = 0, field = 0, nul = 0;
+    if (ok) {
+        const char *map = cache->map;
+        value = (long) ((const char *) cache->fields - map);
+        field = (long) ((const char *) &cache->records[1].field - map);
+        nul = (long) (cache->values + cache->fields[1] - 1 - map);
+    }
+    csv_cache_destroy(cache);
+
+    ok = ok && csv_cache_build(path, ",", NULL) &&
+        s_patch_file(cache_path, value, &far, sizeof(far)) &&
+        csv_cache_load(path, ',', NULL) == NULL;
+    ok = ok && csv_cache_build(path, ",", NULL) &&
+        s_patch_file(cache_path, field, &zero, sizeof(zero)) &&
+        csv_cache_load(path, ',', NULL) == NULL;
+    ok = ok && csv_cache_build(path, ",", NULL) &&
+        s_patch_file(cache_path, nul, "x", 1) &&
+        csv_cache_load(path, ',', NULL) == NULL;
+
+    /* The parser builds the cache again, and reads the same rows */
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+    ok = ok && csv_parser_cache(csv_parser, NULL) &&
+        s_expect_rows(csv_parser, expected);
+    csv_parser_destroy(csv_parser);
+    remove(cache_path);
+
+    return ok;
+}
+
+
+/**
+ * @brief Write a file with records of every kind the grammar allows
+ *
+ * Quoted fields span lines, with delimiters and doubled quotes inside,
+ * some records end in CRLF, some fields hold a bare CR, comment and blank
+ * lines come in between, a few records are longer than a chunk or block
+ * of the test build, and the last one has no final newline.
+ *
+ * @param path Path to the file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_put_corpus(const char *path)
+{
+    static const char *const values[] = {
+        "plain", "", "\"with, delimiter\"", "\"two\nlines\"",
+        "\"doubled \"\"quotes\"\"\"", "12345", "\"\"", "bare\rcr",
+        "\"\n\"", "# not a comment",
+    };
+    const size_t num_values = sizeof(values) / sizeof(values[0]);
+    const size_t num_records = 600;
+    uint32_t seed = 1;
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    bool ok = fputs("id,a,b\n", fp) >= 0;
+    for (size_t i = 0; ok && i < num_records; ++i) {
+        if (i % 7 == 3) {
+            ok = fputs("# comment, with \"a quote\n", fp) >= 0;
+        } else if (i % 11 == 5) {
+            ok = fputs((i % 2 == 0) ? "\n" : "\r\n", fp) >= 0;
+        }
+
+        seed = seed * 1103515245u + 12345u;
+        const char *a = values[(seed >> 16) % num_values];
+        seed = seed * 1103515245u + 12345u;
+        const char *b = values[(seed >> 16) % num_values];
+        ok = ok && fprintf(fp, "%zu,%s,%s", i, a, b) >= 0;
+        if (i % 97 == 50) {
+            ok = ok && fputs(",\"", fp) >= 0;
+            for (size_t j = 0; ok && j < 100; ++j) {
+                ok = fputs("x,\n", fp) >= 0;
+            }
+            ok = ok && fputs("\"", fp) >= 0;
+        }
+        if (i + 1 < num_records) {
+            ok = ok && fputs((i % 3 == 0) ? "\r\n" : "\n", fp) >= 0;
+        }
+    }
+
+    return (fclose(fp) == 0) && ok;
+}
+
+
+/**
+ * @brief Compare two rows
+ *
+ * @param a A row, or @c NULL
+ * @param b Another row, or @c NULL
+ *
+ * @return @c true if both have the same fields, or both are @c NULL,
+ *         @c false otherwise
+ */
+static bool s_same_row(const csv_row_td *a, const csv_row_td *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    if (a->num_fields != b->num_fields) {
+        return false;
+    }
+    for (size_t i = 0; i < a->num_fields; ++i) {
+        if (strcmp(a->fields[i], b->fields[i]) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Compare two row views
+ *
+ * @param a A row view, or @c NULL
+ * @param b Another row view, or @c NULL
+ *
+ * @return @c true if both have the same fields, or both are @c NULL,
+ *         @c false otherwise
+ */
+static bool s_same_view(const csv_row_view_td *a, const csv_row_view_td *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    if (a->num_fields != b->num_fields) {
+        return false;
+    }
+    for (size_t i = 0; i < a->num_fields; ++i) {
+        if (a->fields[i].len != b->fields[i].len ||
+                memcmp(a->fields[i].data, b->fields[i].data,
+                    a->fields[i].len) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Compare the rows of two parsers, to the end of both
+ *
+ * @param a A CSV parser
+ * @param b Another CSV parser
+ *
+ * @return @c true if both read the same rows, @c false otherwise
+ */
+static bool s_same_rows(csv_parser_td *a, csv_parser_td *b)
+{
+    const csv_row_view_td *view;
+
+    do {
+        view = csv_parser_row_view(a);
+        if (!s_same_view(view, csv_parser_row_view(b))) {
+            return false;
+        }
+    } while (view != NULL);
+
+    return true;
+}
+
+
+/**
+ * @brief Read and count records in parallel as the parser does
+ *
+ * The chunks of the test build are smaller than some records, so
+ * records, quoted newlines and CRLF terminators straddle their edges.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_parallel(const char *path)
+{
+    bool ok = s_put_corpus(path);
+
+    for (size_t threads = 1; ok && threads <= 4; threads += 3) {
+        csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+        csv_parallel_td *csv_parallel = csv_parallel_init(path, ",", true,
+                threads);
+        size_t count = 0, num_rows = 0;
+        ok = csv_parser != NULL && csv_parallel != NULL &&
+            s_same_row(csv_parser_header(csv_parser),
+                    csv_parallel_header(csv_parallel));
+
+        const csv_row_view_td *view = NULL;
+        while (ok && (view = csv_parser_row_view(csv_parser)) != NULL) {
+            ok = s_same_view(view, csv_parallel_row_view(csv_parallel));
+            num_rows++;
+        }
+        ok = ok && csv_parallel_row_view(csv_parallel) == NULL &&
+            csv_count_records(path, ",", true, threads, &count) &&
+            count == num_rows;
+        csv_parallel_destroy(csv_parallel);
+        csv_parser_destroy(csv_parser);
+    }
+
+    return ok;
+}
+
+
+/**
+ * @brief Read records in a pipeline as the parser does
+ *
+ * The blocks of the test build are smaller than some records, so
+ * records, quoted newlines and CRLF terminators straddle their edges.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_pipeline(const char *path)
+{
+    bool ok = s_put_corpus(path);
+
+    for (size_t parsers = 1; ok && parsers <= 4; parsers += 3) {
+        csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+        csv_pipeline_td *csv_pipeline = csv_pipeline_init(path, ",", true,
+                parsers);
+        ok = csv_parser != NULL && csv_pipeline != NULL &&
+            s_same_row(csv_parser_header(csv_parser),
+                    csv_pipeline_header(csv_pipeline));
+
+        const csv_row_view_td *view = NULL;
+        while (ok && (view = csv_parser_row_view(csv_parser)) != NULL) {
+            ok = s_same_view(view, csv_pipeline_row_view(csv_pipeline));
+        }
+        ok = ok && csv_pipeline_row_view(csv_pipeline) == NULL &&
+            !csv_pipeline_failed(csv_pipeline);
+        csv_pipeline_destroy(csv_pipeline);
+        csv_parser_destroy(csv_parser);
+    }
+
+    return ok;
+}
+
+
+/**
+ * @brief Write fields that need quoting, and read them back
+ *
+ * Both fields given one by one and the rows of a parser are written,
+ * and parsing the output gives the same fields.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_writer_round_trip(const char *path)
+{
+    static const char *const rows[][4] = {
+        { "plain", "with,delimiter", "with \"quotes\"", NULL },
+        { "two\nlines", "carriage\rreturn", "crlf\r\n", NULL },
+        { "# not a comment", " leading space", "", NULL },
+        { "", "", "", NULL },
+        { "", NULL },
+        { "\"", "\"\"", ",", NULL },
+    };
+    const size_t num_rows = sizeof(rows) / sizeof(rows[0]);
+    char out_path[64];
+
+    csv_writer_td *csv_writer = csv_writer_init(path, ",");
+    bool ok = (csv_writer != NULL);
+    for (size_t i = 0; ok && i < num_rows; ++i) {
+        for (size_t j = 0; ok && rows[i][j] != NULL; ++j) {
+            ok = csv_writer_field(csv_writer, rows[i][j],
+                    strlen(rows[i][j]));
+        }
+        ok = ok && csv_writer_end_record(csv_writer);
+    }
+    ok = ok && csv_writer_flush(csv_writer);
+    csv_writer_destroy(csv_writer);
+
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", false);
+    for (size_t i = 0; ok && i < num_rows; ++i) {
+        const csv_row_view_td *view = csv_parser_row_view(csv_parser);
+        size_t j = 0;
+        while (ok && view != NULL && rows[i][j] != NULL) {
+            ok = j < view->num_fields &&
+                view->fields[j].len == strlen(rows[i][j]) &&
+                memcmp(view->fields[j].data, rows[i][j],
+                        view->fields[j].len) == 0;
+            j++;
+        }
+        ok = ok && view != NULL && j == view->num_fields;
+    }
+    ok = ok && csv_parser_row_view(csv_parser) == NULL;
+    csv_parser_destroy(csv_parser);
+
+    /* Copy every row of the corpus, and read both files */
+    ok = ok && s_sidecar(out_path, sizeof(out_path), path, ".out") &&
+        s_put_corpus(path);
+    csv_parser = (ok) ? csv_parser_init(path, ",", false) : NULL;
+    csv_writer = (ok) ? csv_writer_init(out_path, ",") : NULL;
+    const csv_row_view_td *view;
+    ok = csv_parser != NULL && csv_writer != NULL;
+    while (ok && (view = csv_parser_row_view(csv_parser)) != NULL) {
+        ok = csv_writer_row_view(csv_writer, view);
+    }
+    ok = ok && csv_writer_flush(csv_writer);
+    csv_writer_destroy(csv_writer);
+    csv_parser_destroy(csv_parser);
+
+    csv_parser = csv_parser_init(path, ",", false);
+    csv_parser_td *copy = csv_parser_init(out_path, ",", false);
+    ok = ok && csv_parser != NULL && copy != NULL &&
+        s_same_rows(csv_parser, copy);
+    csv_parser_destroy(copy);
+    csv_parser_destroy(csv_parser);
+    remove(out_path);
+
+    return ok;
+}
+
+
+/**
+ * @brief Seek through a valid index to the rows a scan reaches
+ *
+ * The index of the test build samples every few records, so most seeks
+ * start at a sample and skip some records after it.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_index_seek(const char *path)
+{
+    char idx_path[64];
+    bool ok = s_sidecar(idx_path, sizeof(idx_path), path, CSV_INDEX_SUFFIX) &&
+        s_put_corpus(path) && csv_index_build(path, ",") &&
+        s_index_loads(path);
+
+    csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+    const csv_row_view_td *view;
+    size_t num_rows = 0;
+    while (ok && (view = csv_parser_row_view(csv_parser)) != NULL) {
+        if (num_rows % 13 == 0) {
+            csv_parser_td *seeker = csv_parser_init(path, ",", true);
+            ok = csv_parser_seek_row(seeker, num_rows) &&
+                s_same_view(view, csv_parser_row_view(seeker));
+            csv_parser_destroy(seeker);
+        }
+        num_rows++;
+    }
+    csv_parser_destroy(csv_parser);
+
+    csv_parser = csv_parser_init(path, ",", true);
+    ok = ok && num_rows > 0 && !csv_parser_seek_row(csv_parser, num_rows) &&
+        csv_parser_seek_row(csv_parser, num_rows - 1) &&
+        csv_parser_row_view(csv_parser) != NULL &&
+        csv_parser_row_view(csv_parser) == NULL;
+    csv_parser_destroy(csv_parser);
+    remove(idx_path);
+
+    return ok;
+}
+
+
+/**
+ * @brief Read the same rows from a valid parse cache as from the file
+ *
+ * The cache is built by the first parser, and loaded by the second one,
+ * which switches to it after a few rows.
+ *
+ * @param path Scratch file
+ *
+ * @return @c true on success, @c false otherwise
+ */
+static bool s_test_cache_load(const char *path)
+{
+    char cache_path[64];
+    bool ok = s_sidecar(cache_path, sizeof(cache_path), path,
+            CSV_CACHE_SUFFIX) && s_put_corpus(path);
+
+    for (size_t skip = 0; ok && skip <= 10; skip += 10) {
+        csv_parser_td *csv_parser = csv_parser_init(path, ",", true);
+        csv_parser_td *cached = csv_parser_init(path, ",", true);
+        ok = csv_parser != NULL && cached != NULL &&
+            s_same_row(csv_parser_header(csv_parser),
+                    csv_parser_header(cached));
+        for (size_t i = 0; ok && i < skip; ++i) {
+            ok = s_same_view(csv_parser_row_view(csv_parser),
+                    csv_parser_row_view(cached));
+        }
+        ok = ok && csv_parser_cache(cached, NULL) &&
+            s_same_rows(csv_parser, cached);
+        csv_parser_destroy(cached);
+        csv_parser_destroy(csv_parser);
+
+        csv_cache_td *cache = csv_cache_load(path, ',', NULL);
+        ok = ok && cache != NULL;
+        csv_cache_destroy(cache);
+    }
+    remove(cache_path);
+
+    return ok;
+}
+
+
+/* Every regression case */
+static const csv_test_td s_tests[] = {
+    { "refresh after a trailing blank line", s_test_refresh_blank },
+    { "refresh after a trailing comment line", s_test_refresh_comment },
+    { "refresh after a last record without its newline",
+        s_test_refresh_open },
+    { "bare carriage return in a field", s_test_bare_cr },
+    { "dates in January and February of year 0000",
+        s_test_date_year_zero },
+    { "corrupt row index", s_test_index_corrupt },
+    { "seeking past the last row", s_test_seek_end },
+    { "schema inference within its budget", s_test_infer_budget },
+    { "corrupt parse cache", s_test_cache_corrupt },
+    { "parallel parser and record count", s_test_parallel },
+    { "pipelined parser", s_test_pipeline },
+    { "writer round trip", s_test_writer_round_trip },
+    { "seeking through a row index", s_test_index_seek },
+    { "reading through a parse cache", s_test_cache_load },
+};
+
+
+int main(void)
+{
+    char path[] = "/tmp/csvtestXXXXXX";
+    int failed = 0;
+
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    for (size_t i = 0; i < sizeof(s_tests) / sizeof(s_tests[0]); ++i) {
+        bool ok = s_tests[i].run(path);
+        printf("%s: %s\n", (ok) ? "PASS" : "FAIL", s_tests[i].name);
+        failed += (ok) ? 0 : 1;
+    }
+    remove(path);
+
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}